@@ -0,0 +1,56 @@
+# writes the translations of a oyjl i18n JSON file as sorted C tables
+# for a binary search per msgid; needs CMake 3.19 for string(JSON)
+#
+# cmake -DINPUT=xcalib.i18n.json -DOUTPUT=xcalib.i18n.tab.h -DNAME=xcalib_i18n -P xcalibI18nTable.cmake
+
+if (CMAKE_VERSION VERSION_LESS 3.19)
+    message(FATAL_ERROR "string(JSON) needs CMake 3.19")
+endif ()
+
+file(READ "${INPUT}" json)
+string(JSON langs ERROR_VARIABLE err LENGTH "${json}" org freedesktop oyjl translations)
+if (err)
+    message(FATAL_ERROR "${INPUT}: ${err}")
+endif ()
+
+# the unit separator keeps msgid and msgstr apart while sorting
+string(ASCII 31 sep)
+get_filename_component(source "${INPUT}" NAME)
+set(out "/* generated from ${source} by cmake/xcalibI18nTable.cmake - do not edit */\n\n")
+set(index "")
+math(EXPR last "${langs} - 1")
+foreach (l RANGE ${last})
+    string(JSON lang MEMBER "${json}" org freedesktop oyjl translations ${l})
+    string(JSON count LENGTH "${json}" org freedesktop oyjl translations ${lang})
+    set(entries "")
+    if (count GREATER 0)
+        math(EXPR n "${count} - 1")
+        foreach (i RANGE ${n})
+            string(JSON msgid MEMBER "${json}" org freedesktop oyjl translations ${lang} ${i})
+            string(JSON msgstr GET "${json}" org freedesktop oyjl translations ${lang} "${msgid}")
+            # untranslated entries fall back to the msgid
+            if (NOT msgstr STREQUAL "")
+                foreach (s msgid msgstr)
+                    string(REPLACE "\\" "\\\\" ${s} "${${s}}")
+                    string(REPLACE "\"" "\\\"" ${s} "${${s}}")
+                    string(REPLACE "\n" "\\n" ${s} "${${s}}")
+                endforeach ()
+                list(APPEND entries "${msgid}${sep}${msgstr}")
+            endif ()
+        endforeach ()
+    endif ()
+    # bytewise order as with strcmp()
+    list(SORT entries)
+    list(LENGTH entries size)
+    string(MAKE_C_IDENTIFIER "${NAME}_${lang}" table)
+    string(APPEND out "static const char * const ${table}[][2] = {\n")
+    foreach (e ${entries})
+        string(REPLACE "${sep}" "\", \"" e "${e}")
+        string(APPEND out "  {\"${e}\"},\n")
+    endforeach ()
+    string(APPEND out "  {0, 0}\n};\n\n")
+    string(APPEND index "  {\"${lang}\", ${table}, ${size}},\n")
+endforeach ()
+
+string(APPEND out "static const struct {\n  const char * lang;\n  const char * const (*table)[2];\n  int size;\n} ${NAME}_tables[] = {\n${index}  {0, 0, 0}\n};\n")
+file(WRITE "${OUTPUT}" "${out}")
@@ -0,0 +1,3035 @@
+/*
+ * xcalib - download vcgt gamma tables to your X11 video card
+ *
+ * (c) 2004-2005 Stefan Doehla <stefan AT doehla DOT de>
+ *
+ * This program is GPL-ed postcardware! please see README
+ *
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA.
+ */
+
+/*
+ * libxcalib holds the ICC parsing, the ramp computation, the ramp cache
+ * and the XRandR upload of xcalib. It has no dependency on Oyjl; all
+ * state is passed in by the caller. See xcalib.h for the stages.
+ */
+
+/* vim: set ai ts=2 sw=2 expandtab: */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+# include <sys/mman.h>
+# include <strings.h>
+# include <unistd.h>
+#else
+# include <windows.h>
+# include <direct.h>
+# include <process.h>
+# define strcasecmp _stricmp
+#endif
+
+#include <math.h>
+
+#include "xcalib.h"
+
+#ifdef HAVE_XCB
+# include <X11/Xlib-xcb.h>
+# include <xcb/randr.h>
+#endif
+
+#if defined(__GNUC__) || defined(_MSC_VER)
+# define XCALIB_RESTRICT __restrict
+#else
+# define XCALIB_RESTRICT
+#endif
+
+/* the 4-byte marker for the vcgt-Tag */
+#define VCGT_TAG     0x76636774L
+#define MLUT_TAG     0x6d4c5554L
+#define DESC_TAG     0x64657363L
+#define MLUC_TYPE    0x6d6c7563L
+
+#ifdef _WIN32
+# define u_int16_t  WORD
+# define getpid     _getpid
+# define MKDIR(d)   _mkdir(d)
+#else
+# define MKDIR(d)   mkdir(d, 0755)
+#endif
+
+/* on disk ramp cache; bump the version whenever the ramp computation changes */
+#define RAMP_CACHE_VERSION "3"
+#define RAMP_CACHE_MAGIC   "xcalibR\001"
+#define RAMP_CACHE_HEADER  16
+
+/* ramp files of xcalib_ramp_print(); see XCALIB_RAMP_MAGIC */
+#define RAMP_FILE_HEADER   16
+#define LE_INT(a)     ((a)[0]+((a)[1]<<8)+((a)[2]<<16)+((unsigned int)(a)[3]<<24))
+#define LE_SHORT(a)   ((a)[0]+((a)[1]<<8))
+
+#if 1
+# define BE_INT(a)    ((a)[3]+((a)[2]<<8)+((a)[1]<<16) +((a)[0]<<24))
+# define BE_SHORT(a)  ((a)[1]+((a)[0]<<8))
+#else
+# warning "big endian is NOT TESTED"
+# define BE_INT(a)    (a)
+# define BE_SHORT(a)  (a)
+#endif
+
+/* one entry of the ICC tag table */
+typedef struct {
+  unsigned int sig;
+  unsigned int offset;
+  unsigned int size;
+} xcalib_tag_t;
+
+/* ICC profile in memory */
+typedef struct {
+  const unsigned char * data;
+  size_t size;
+  int mapped;                          /* 1 - mmap(), 0 - malloc() */
+  unsigned int ntags;
+  xcalib_tag_t * tags;                 /* validated, sorted by sig */
+} xcalib_icc_t;
+
+static int xcalib_message_default    ( int                 code,
+                                       const void        * context,
+                                       const char        * format,
+                                       ... );
+static xcalib_message_f xcalib_msg = xcalib_message_default;
+
+#if defined(__GNUC__)
+# define XCALIB_DBG_FORMAT "%s:%d %s() "
+# define XCALIB_DBG_ARGS   strrchr(__FILE__,'/') ? strrchr(__FILE__,'/')+1 : __FILE__,__LINE__,__func__
+#else
+# define XCALIB_DBG_FORMAT "%s:%d "
+# define XCALIB_DBG_ARGS   strrchr(__FILE__,'/') ? strrchr(__FILE__,'/')+1 : __FILE__,__LINE__
+#endif
+#define warning(format, ...) xcalib_msg( XCALIB_MSG_WARNING, 0, XCALIB_DBG_FORMAT format, XCALIB_DBG_ARGS, __VA_ARGS__ )
+#define message(state, format, ...) do { if((state)->verbose) \
+  xcalib_msg( XCALIB_MSG_INFO, state, XCALIB_DBG_FORMAT format, XCALIB_DBG_ARGS, __VA_ARGS__ ); } while(0)
+
+static int
+xcalib_message_default(int code, const void * context, const char * format, ...)
+{
+  va_list list;
+
+  (void)context;
+  fprintf( stderr, "%s", code == XCALIB_MSG_INFO ? "Info: " :
+                         code == XCALIB_MSG_WARNING ? "Warning: " : "Error: " );
+  va_start( list, format );
+  vfprintf( stderr, format, list );
+  va_end( list );
+  fprintf( stderr, "\n" );
+
+  return 0;
+}
+
+/*
+ * FUNCTION xcalib_set_message_func
+ *
+ * routes all library messages to func; NULL restores printing to stderr
+ */
+void
+xcalib_set_message_func(xcalib_message_f func)
+{
+  xcalib_msg = func ? func : xcalib_message_default;
+}
+
+/*
+ * FUNCTION xcalib_ramp_new
+ *
+ * allocates a ramp of size entries per channel in one block
+ *
+ * returns the ramp or NULL
+ */
+xcalib_ramp_t *
+xcalib_ramp_new(unsigned int size)
+{
+  xcalib_ramp_t * ramp;
+
+  if(!size)
+    return NULL;
+  ramp = (xcalib_ramp_t *) calloc (1, sizeof (xcalib_ramp_t) + 3 * size * sizeof (u_int16_t));
+  if(!ramp)
+    return NULL;
+  ramp->size = size;
+  ramp->red = (u_int16_t *) (ramp + 1);
+  ramp->green = ramp->red + size;
+  ramp->blue = ramp->green + size;
+
+  return ramp;
+}
+
+/*
+ * FUNCTION xcalib_ramp_release
+ *
+ * frees a ramp from xcalib_ramp_new() and resets the pointer
+ */
+void
+xcalib_ramp_release(xcalib_ramp_t ** ramp)
+{
+  if(!ramp)
+    return;
+  free(*ramp);
+  *ramp = NULL;
+}
+
+/*
+ * FUNCTION resample_ramps
+ *
+ * resamples all three channels from src_size to dst_size entries.
+ * Entry k of the destination is read from position
+ * k * (src_size - 1) / (dst_size - 1) of the source, which keeps both end
+ * points for any pair of sizes. Values are interpolated linearly in
+ * 16.16 fixed point. The positions are stepped without divisions and
+ * computed once for all channels, leaving the per channel loops
+ * branch free for the compiler to vectorise.
+ *
+ * returns
+ * -1: error
+ * 1: success
+ */
+static int
+resample_ramps(const u_int16_t * src_r, const u_int16_t * src_g,
+               const u_int16_t * src_b, unsigned int src_size,
+               u_int16_t * r_ramp, u_int16_t * g_ramp, u_int16_t * b_ramp,
+               unsigned int dst_size)
+{
+  unsigned int * index, * weight;
+  unsigned long long q = 0, q_step, r = 0, r_step, den;
+  unsigned int k;
+
+  if(src_size == dst_size)
+  {
+    memcpy(r_ramp, src_r, dst_size * sizeof (u_int16_t));
+    memcpy(g_ramp, src_g, dst_size * sizeof (u_int16_t));
+    memcpy(b_ramp, src_b, dst_size * sizeof (u_int16_t));
+    return 1;
+  }
+  if(src_size < 2 || dst_size < 2)
+    return -1;
+
+  index = (unsigned int *) malloc (2 * dst_size * sizeof (unsigned int));
+  if(!index)
+    return -1;
+  weight = index + dst_size;
+
+  /* q = k * (src_size - 1) * 65536 / (dst_size - 1) with exact carry */
+  den = dst_size - 1;
+  q_step = ((unsigned long long)(src_size - 1) << 16) / den;
+  r_step = ((unsigned long long)(src_size - 1) << 16) % den;
+  for(k = 0; k < dst_size; ++k)
+  {
+    index[k] = (unsigned int)(q >> 16);
+    weight[k] = (unsigned int)(q & 0xffff);
+    if(index[k] >= src_size - 1)
+    {
+      index[k] = src_size - 2;
+      weight[k] = 65536;
+    }
+    q += q_step;
+    r += r_step;
+    if(r >= den)
+    {
+      r -= den;
+      ++q;
+    }
+  }
+
+  for(k = 0; k < dst_size; ++k)
+    r_ramp[k] = (src_r[index[k]] * (65536 - weight[k]) + src_r[index[k]+1] * weight[k]) >> 16;
+  for(k = 0; k < dst_size; ++k)
+    g_ramp[k] = (src_g[index[k]] * (65536 - weight[k]) + src_g[index[k]+1] * weight[k]) >> 16;
+  for(k = 0; k < dst_size; ++k)
+    b_ramp[k] = (src_b[index[k]] * (65536 - weight[k]) + src_b[index[k]+1] * weight[k]) >> 16;
+
+  free(index);
+  return 1;
+}
+
+/*
+ * FUNCTION xcalib_ramp_resample
+ *
+ * resamples src to the size of dst
+ *
+ * returns
+ * -1: error
+ * 1: success
+ */
+int
+xcalib_ramp_resample(const xcalib_ramp_t * src, xcalib_ramp_t * dst)
+{
+  return resample_ramps(src->red, src->green, src->blue, src->size,
+                        dst->red, dst->green, dst->blue, dst->size);
+}
+
+/*
+ * FUNCTION mix_channel
+ *
+ * blends two channels with 16-bit weights v + w = 65536. The sum stays
+ * below 2^32, so the loop runs in 32-bit lanes and vectorises.
+ */
+static void
+mix_channel(const u_int16_t * XCALIB_RESTRICT a, const u_int16_t * XCALIB_RESTRICT b,
+            u_int16_t * XCALIB_RESTRICT out, unsigned int n,
+            unsigned int v, unsigned int w)
+{
+  unsigned int i;
+
+  for(i = 0; i < n; ++i)
+    out[i] = (u_int16_t)((a[i] * v + b[i] * w + 32768u) >> 16);
+}
+
+/*
+ * FUNCTION xcalib_ramp_mix
+ *
+ * interpolates between two ramps of the same size; t = 0 gives from,
+ * t = 1 gives to
+ *
+ * returns
+ * -1: error
+ * 1: success
+ */
+int
+xcalib_ramp_mix(const xcalib_ramp_t * from, const xcalib_ramp_t * to,
+                double t, xcalib_ramp_t * out)
+{
+  unsigned int w;
+
+  if(from->size != to->size || to->size != out->size)
+    return -1;
+
+  w = t <= 0.0 ? 0 : t >= 1.0 ? 65536 : (unsigned int)(t * 65536.0 + 0.5);
+  mix_channel(from->red, to->red, out->red, out->size, 65536 - w, w);
+  mix_channel(from->green, to->green, out->green, out->size, 65536 - w, w);
+  mix_channel(from->blue, to->blue, out->blue, out->size, 65536 - w, w);
+
+  return 1;
+}
+
+/*
+ * FUNCTION icc_map_file
+ *
+ * makes the whole ICC profile available as one read-only memory block.
+ * mmap() is used where available; otherwise or on failure the file is
+ * read in one go into a malloc()ed buffer.
+ *
+ * returns
+ * -1: file could not be opened or read
+ * 0: success
+ */
+static int
+icc_map_file(const char * filename, xcalib_icc_t * icc)
+{
+  FILE * fp;
+  long size;
+
+  memset(icc, 0, sizeof(*icc));
+  if(!filename)
+    return -1; /* filename char pointer not valid */
+
+#ifndef _WIN32
+  {
+    struct stat st;
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0)
+      return -1; /* file can not be opened */
+    if(fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+      void * data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(data != MAP_FAILED)
+      {
+        close(fd);
+        icc->data = data;
+        icc->size = st.st_size;
+        icc->mapped = 1;
+        return 0;
+      }
+    }
+    close(fd);
+  }
+#endif
+
+  /* fallback: read whole file */
+  fp = fopen(filename, "rb");
+  if(!fp)
+    return -1;
+  if(fseek(fp, 0, SEEK_END) || (size = ftell(fp)) <= 0 || fseek(fp, 0, SEEK_SET))
+  {
+    fclose(fp);
+    return -1;
+  }
+  icc->data = malloc(size);
+  if(icc->data && fread((void*)icc->data, 1, size, fp) == (size_t)size)
+    icc->size = size;
+  else
+  {
+    free((void*)icc->data);
+    icc->data = NULL;
+  }
+  fclose(fp);
+
+  return icc->data ? 0 : -1;
+}
+
+/*
+ * FUNCTION icc_unmap_file
+ *
+ * releases the memory obtained by icc_map_file and icc_read_tags
+ */
+static void
+icc_unmap_file(xcalib_icc_t * icc)
+{
+  free(icc->tags);
+  if(icc->data)
+  {
+#ifndef _WIN32
+    if(icc->mapped)
+      munmap((void*)icc->data, icc->size);
+    else
+#endif
+      free((void*)icc->data);
+  }
+  memset(icc, 0, sizeof(*icc));
+}
+
+static int
+icc_tag_compare(const void * a, const void * b)
+{
+  unsigned int sa = ((const xcalib_tag_t*)a)->sig,
+               sb = ((const xcalib_tag_t*)b)->sig;
+  return sa < sb ? -1 : sa > sb;
+}
+
+/*
+ * FUNCTION icc_read_tags
+ *
+ * builds the tag directory of a ICC profile mapped with icc_map_file.
+ * All tags are validated against the file size and sorted by signature
+ * for icc_find_tag(). On error the file is unmapped.
+ *
+ * returns
+ * -1: file is corrupt
+ * 0: success
+ */
+static int
+icc_read_tags(const char * filename, xcalib_icc_t * icc)
+{
+  unsigned int i;
+
+  /* header plus tag count */
+  if(icc->size < 128+4)
+  {
+    warning("file too small for a ICC profile: %u bytes '%s'",
+            (unsigned int)icc->size, filename);
+    icc_unmap_file(icc);
+    return -1;
+  }
+  icc->ntags = BE_INT(icc->data + 128);
+  if(icc->ntags > (icc->size - 128 - 4) / 12)
+  {
+    warning("tag table exceeds file size: %u tags in %u bytes '%s'",
+            icc->ntags, (unsigned int)icc->size, filename);
+    icc_unmap_file(icc);
+    return -1;
+  }
+  if(!icc->ntags)
+    return 0;
+
+  icc->tags = (xcalib_tag_t *) malloc (icc->ntags * sizeof (xcalib_tag_t));
+  if(!icc->tags)
+  {
+    icc_unmap_file(icc);
+    return -1;
+  }
+  for(i = 0; i < icc->ntags; ++i)
+  {
+    const unsigned char * tag = icc->data + 128 + 4 + i * 12;
+    xcalib_tag_t * t = &icc->tags[i];
+    t->sig = BE_INT(tag);
+    t->offset = BE_INT(tag + 4);
+    t->size = BE_INT(tag + 8);
+    if(t->offset > icc->size || t->size > icc->size - t->offset)
+    {
+      warning("tag %x exceeds file size: offset %u size %u '%s'",
+              t->sig, t->offset, t->size, filename);
+      icc_unmap_file(icc);
+      return -1;
+    }
+  }
+  qsort(icc->tags, icc->ntags, sizeof(xcalib_tag_t), icc_tag_compare);
+
+  return 0;
+}
+
+/*
+ * FUNCTION icc_find_tag
+ *
+ * returns the directory entry of tag sig or NULL
+ */
+static const xcalib_tag_t *
+icc_find_tag(const xcalib_icc_t * icc, unsigned int sig)
+{
+  xcalib_tag_t key;
+  if(!icc->tags)
+    return NULL;
+  key.sig = sig;
+  return (const xcalib_tag_t *) bsearch(&key, icc->tags, icc->ntags,
+                                        sizeof(xcalib_tag_t), icc_tag_compare);
+}
+
+/*
+ * FUNCTION icc_get_profile_id
+ *
+ * copies the 16 byte profile ID (MD5) from the header
+ *
+ * returns
+ * 0: profile carries no ID (all zero)
+ * 1: success
+ */
+static int
+icc_get_profile_id(const xcalib_icc_t * icc, unsigned char id[16])
+{
+  int i, set = 0;
+  memset(id, 0, 16);
+  if(icc->size < 100)
+    return 0;
+  memcpy(id, icc->data + 84, 16);
+  for(i = 0; i < 16; ++i)
+    set |= id[i];
+  return set != 0;
+}
+
+/*
+ * FUNCTION icc_get_description
+ *
+ * copies the ASCII part of the desc tag into text;
+ * ICC v2 'desc' and the first record of ICC v4 'mluc' are understood
+ *
+ * returns the length of text
+ */
+static int
+icc_get_description(const xcalib_icc_t * icc, char * text, int max)
+{
+  const xcalib_tag_t * t = icc_find_tag(icc, DESC_TAG);
+  const unsigned char * p;
+  unsigned int type, count, offset, i, n = 0;
+
+  text[0] = '\000';
+  if(!t || t->size < 12 || max < 1)
+    return 0;
+  p = icc->data + t->offset;
+  type = BE_INT(p);
+  if(type == DESC_TAG)
+  {
+    count = BE_INT(p + 8);
+    if(count > t->size - 12)
+      count = t->size - 12;
+    for(i = 0; i < count && p[12+i] && n < max-1; ++i)
+      text[n++] = p[12+i];
+  }
+  else if(type == MLUC_TYPE && t->size >= 28)
+  {
+    count = BE_INT(p + 20) / 2;
+    offset = BE_INT(p + 24);
+    if(offset > t->size || count > (t->size - offset) / 2)
+      count = 0;
+    for(i = 0; i < count && n < max-1; ++i)
+      text[n++] = p[offset + 2*i] ? '?' : p[offset + 2*i + 1];
+  }
+  text[n] = '\000';
+
+  return n;
+}
+
+/*
+ * FUNCTION read_mlut_tag
+ *
+ * Profile Mechanic mLUT: 3 x 256 x 16bit
+ */
+static int
+read_mlut_tag(const xcalib_icc_t * icc, const xcalib_tag_t * tag,
+              u_int16_t * rRamp, u_int16_t * gRamp, u_int16_t * bRamp,
+              unsigned int nEntries)
+{
+  const unsigned char * p = icc->data + tag->offset;
+  u_int16_t table[3 * 256];
+  int j;
+
+  if(tag->size < 3 * 256 * 2)
+  {
+    warning("mLUT too small: %u bytes", tag->size);
+    return 0;
+  }
+  for(j=0; j<3 * 256; j++)
+    table[j] = BE_SHORT(p + 2 * j);
+
+  return resample_ramps(table, table + 256, table + 512, 256,
+                        rRamp, gRamp, bRamp, nEntries);
+}
+
+/*
+ * FUNCTION read_vcgt_tag
+ *
+ * Apple vcgt: VideoCardGammaFormula or VideoCardGammaTable
+ */
+static int
+read_vcgt_tag(const xcalib_icc_t * icc, const xcalib_tag_t * tag,
+              const char * filename, const xcalib_state_t * state,
+              u_int16_t * rRamp, u_int16_t * gRamp, u_int16_t * bRamp,
+              unsigned int nEntries)
+{
+  const unsigned char * p = icc->data + tag->offset;
+  unsigned int tagSize = tag->size;
+  unsigned int tagName;
+  unsigned int uTmp;
+  unsigned int gammaType;
+
+  u_int16_t * redRamp = NULL, * greenRamp = NULL, * blueRamp = NULL;
+  int ret;
+  /* formula */
+  float rGamma, rMin, rMax;
+  float gGamma, gMin, gMax;
+  float bGamma, bMin, bMax;
+  /* table */
+  unsigned int numChannels=0;
+  unsigned int numEntries=0;
+  unsigned int entrySize=0;
+  int j=0;
+
+  if(tagSize < 12)
+  {
+    warning("vcgt too small: %u bytes", tagSize);
+    return 0;
+  }
+  tagName = BE_INT(p);
+  if(tagName != VCGT_TAG)
+  {
+    warning("invalid content of table vcgt, starting with %x",
+          tagName);
+    return 0;
+  }
+  gammaType = BE_INT(p + 8);
+  p += 12;
+  /* VideoCardGammaFormula */
+  if(gammaType==1)
+  {
+    if(tagSize < 12 + 9 * 4)
+    {
+      warning("vcgt formula too small: %u bytes", tagSize);
+      return 0;
+    }
+    uTmp = BE_INT(p);      rGamma = (float)uTmp/65536.0;
+    uTmp = BE_INT(p + 4);  rMin = (float)uTmp/65536.0;
+    uTmp = BE_INT(p + 8);  rMax = (float)uTmp/65536.0;
+    uTmp = BE_INT(p + 12); gGamma = (float)uTmp/65536.0;
+    uTmp = BE_INT(p + 16); gMin = (float)uTmp/65536.0;
+    uTmp = BE_INT(p + 20); gMax = (float)uTmp/65536.0;
+    uTmp = BE_INT(p + 24); bGamma = (float)uTmp/65536.0;
+    uTmp = BE_INT(p + 28); bMin = (float)uTmp/65536.0;
+    uTmp = BE_INT(p + 32); bMax = (float)uTmp/65536.0;
+
+    if(rGamma > 5.0 || gGamma > 5.0 || bGamma > 5.0)
+    {
+      warning("Gamma values out of range (> 5.0): \nR: %f \tG: %f \t B: %f",
+            rGamma, gGamma, bGamma);
+      return 0;
+    }
+    if(rMin >= 1.0 || gMin >= 1.0 || bMin >= 1.0)
+    {
+      warning("Gamma lower limit out of range (>= 1.0): \nRMin: %f \tGMin: %f \t BMin: %f",
+            rMin, gMin, bMin);
+      return 0;
+    }
+    if(rMax > 1.0 || gMax > 1.0 || bMax > 1.0)
+    {
+      warning("Gamma upper limit out of range (> 1.0): \nRMax: %f \tGMax: %f \t BMax: %f",
+            rMax, gMax, bMax);
+      return 0;
+    }
+    message(state, "Red:   Gamma %f \tMin %f \tMax %f", rGamma, rMin, rMax);
+    message(state, "Green: Gamma %f \tMin %f \tMax %f", gGamma, gMin, gMax);
+    message(state, "Blue:  Gamma %f \tMin %f \tMax %f", bGamma, bMin, bMax);
+
+    /* all channels see the same x, so equal gammas share one pow() */
+    for(j=0; j<nEntries; j++)
+    {
+      double x = (double) j / (double) (nEntries);
+      double rPow = pow (x, rGamma * (double) state->gamma_cor);
+      double gPow = gGamma == rGamma ? rPow :
+                    pow (x, gGamma * (double) state->gamma_cor);
+      double bPow = bGamma == rGamma ? rPow : bGamma == gGamma ? gPow :
+                    pow (x, bGamma * (double) state->gamma_cor);
+      rRamp[j] = 65536.0 * (rPow * (rMax - rMin) + rMin);
+      gRamp[j] = 65536.0 * (gPow * (gMax - gMin) + gMin);
+      bRamp[j] = 65536.0 * (bPow * (bMax - bMin) + bMin);
+    }
+    return 1;
+  }
+  /* VideoCardGammaTable */
+  else if(gammaType==0)
+  {
+    if(tagSize < 12 + 6)
+    {
+      warning("vcgt table too small: %u bytes", tagSize);
+      return 0;
+    }
+    numChannels = BE_SHORT(p);
+    numEntries = BE_SHORT(p + 2);
+    entrySize = BE_SHORT(p + 4);
+    p += 6;
+
+    /* work-around for AdobeGamma-Profiles */
+    if(tagSize == 1584) {
+      entrySize = 2;
+      numEntries = 256;
+      numChannels = 3;
+    }
+
+    message(state, "channels:        \t%d", numChannels);
+    message(state, "entry size:      \t%dbits",entrySize  * 8);
+    message(state, "entries/channel: \t%d", numEntries);
+    message(state, "tag size:        \t%d", tagSize);
+                                            
+    if(numChannels!=3)          /* assume we have always RGB */
+      return 0;
+    if((entrySize != 1 && entrySize != 2) || numEntries < 2 ||
+       tagSize - 18 < numChannels * numEntries * entrySize)
+    {
+      warning("vcgt table does not fit into tag: %u x %u x %u bytes, tag size %u",
+              numChannels, numEntries, entrySize, tagSize);
+      return -1;
+    }
+
+    redRamp = (unsigned short *) malloc (3 * numEntries * sizeof (unsigned short));
+    if(!redRamp)
+      return -1;
+    greenRamp = redRamp + numEntries;
+    blueRamp = greenRamp + numEntries;
+    {
+      const unsigned char * gp = p + numEntries * entrySize,
+                          * bp = gp + numEntries * entrySize;
+      rMax = gMax = bMax = -1;
+      rMin = gMin = bMin = 65536;
+      for(j=0; j<numEntries; j++)
+      {
+        if(entrySize == 1)
+        {
+          redRamp[j]   = p[j] << 8;
+          greenRamp[j] = gp[j] << 8;
+          blueRamp[j]  = bp[j] << 8;
+        } else
+        {
+          redRamp[j]   = BE_SHORT(p + 2*j);
+          greenRamp[j] = BE_SHORT(gp + 2*j);
+          blueRamp[j]  = BE_SHORT(bp + 2*j);
+        }
+        if(rMax < redRamp[j])
+          rMax = redRamp[j];
+        if(rMin > redRamp[j])
+          rMin = redRamp[j];
+        if(gMax < greenRamp[j])
+          gMax = greenRamp[j];
+        if(gMin > greenRamp[j])
+          gMin = greenRamp[j];
+        if(bMax < blueRamp[j])
+          bMax = blueRamp[j];
+        if(bMin > blueRamp[j])
+          bMin = blueRamp[j];
+      }
+    }
+    if( abs(rMax-rMin) < 65535/20 &&
+        abs(gMax-gMin) < 65535/20 &&
+        abs(bMax-bMin) < 65535/20
+      )
+    {
+      warning ("Contrast below 5%% in ICC profile '%s'", filename);
+      warning ("min/max for red: %g / %g  green: %g / %g  blue: %g / %g", rMin, rMax, gMin, gMax, bMin, bMax );
+      free(redRamp);
+      return -1;
+    }
+    
+    ret = resample_ramps(redRamp, greenRamp, blueRamp, numEntries,
+                         rRamp, gRamp, bRamp, nEntries);
+    free(redRamp);
+    return ret;
+  }
+
+  return 0;
+}
+
+/* kinds of ramp files besides ICC profiles */
+enum {
+  RAMP_FILE_NONE,
+  RAMP_FILE_BINARY,                    /* -p BINARY */
+  RAMP_FILE_JSON,                      /* -p JSON */
+  RAMP_FILE_TEXT,                      /* -p TEXT, one "r g b" line per entry */
+  RAMP_FILE_CUBE,                      /* 1D .cube LUT */
+  RAMP_FILE_RAW                        /* .raw: the BINARY planes without header */
+};
+
+/*
+ * FUNCTION text_skip
+ *
+ * moves i over white space and '#' comments
+ */
+static size_t
+text_skip(const unsigned char * data, size_t size, size_t i)
+{
+  while(i < size)
+  {
+    if(data[i] == '#')
+      while(i < size && data[i] != '\n')
+        ++i;
+    else if(data[i] == ' ' || data[i] == '\t' || data[i] == '\n' ||
+            data[i] == '\r')
+      ++i;
+    else
+      break;
+  }
+  return i;
+}
+
+/*
+ * FUNCTION ramp_file_detect
+ *
+ * tells ramp files apart from ICC profiles. A ICC profile starts with
+ * its size as big endian number, which never gives a printable first
+ * byte, and carries "acsp" at byte 36. After white space and '#'
+ * comments a number starts TEXT and a .cube keyword a .cube file.
+ *
+ * returns one of RAMP_FILE_*
+ */
+static int
+ramp_file_detect(const unsigned char * data, size_t size, const char * filename)
+{
+  size_t i = 0, len = filename ? strlen(filename) : 0;
+
+  if(size >= RAMP_FILE_HEADER && memcmp(data, XCALIB_RAMP_MAGIC, 4) == 0)
+    return RAMP_FILE_BINARY;
+  if(size >= 40 && memcmp(data + 36, "acsp", 4) == 0)
+    return RAMP_FILE_NONE;
+  if(len > 4 && strcasecmp(filename + len - 4, ".raw") == 0)
+    return RAMP_FILE_RAW;
+  if(len > 5 && strcasecmp(filename + len - 5, ".cube") == 0)
+    return RAMP_FILE_CUBE;
+  i = text_skip(data, size, i);
+  if(i < size && data[i] == '{')
+    return RAMP_FILE_JSON;
+  if(i < size && ((data[i] >= '0' && data[i] <= '9') || data[i] == '.'))
+    return RAMP_FILE_TEXT;
+  if((size - i > 5 && memcmp(data + i, "TITLE", 5) == 0) ||
+     (size - i > 11 && memcmp(data + i, "LUT_1D_SIZE", 11) == 0) ||
+     (size - i > 7 && memcmp(data + i, "DOMAIN_", 7) == 0))
+    return RAMP_FILE_CUBE;
+  return RAMP_FILE_NONE;
+}
+
+/*
+ * FUNCTION text_number
+ *
+ * reads a decimal number like 0.25, 1e-3 or 4096 at *i. strtod() would
+ * need a 0 terminated string and depends on the locale.
+ *
+ * returns
+ * -1: no number at *i
+ * 0: success
+ */
+static int
+text_number(const unsigned char * data, size_t size, size_t * i, double * v)
+{
+  size_t p = *i;
+  double num = 0, scale = 1;
+  int sign = 1, digits = 0, e = 0, esign = 1;
+
+  if(p < size && (data[p] == '-' || data[p] == '+'))
+    sign = data[p++] == '-' ? -1 : 1;
+  while(p < size && data[p] >= '0' && data[p] <= '9')
+  {
+    num = num * 10 + (data[p++] - '0');
+    ++digits;
+  }
+  if(p < size && data[p] == '.')
+    for(++p; p < size && data[p] >= '0' && data[p] <= '9'; ++p, ++digits)
+      num += (data[p] - '0') * (scale *= 0.1);
+  if(!digits)
+    return -1;
+  if(p < size && (data[p] == 'e' || data[p] == 'E'))
+  {
+    ++p;
+    if(p < size && (data[p] == '-' || data[p] == '+'))
+      esign = data[p++] == '-' ? -1 : 1;
+    while(p < size && data[p] >= '0' && data[p] <= '9' && e < 400)
+      e = e * 10 + (data[p++] - '0');
+  }
+
+  *v = sign * num * pow(10.0, esign * e);
+  *i = p;
+  return 0;
+}
+
+/*
+ * FUNCTION text_ramp_read
+ *
+ * reads TEXT as written by -p or the table of a 1D .cube file, three
+ * values per entry, into the planes of table, if not NULL. .cube values
+ * span 0.0 - 1.0 and are scaled by 65535. Keyword lines are skipped,
+ * LUT_1D_SIZE is checked against the number of entries. A ramp covers
+ * the input range 0.0 - 1.0, so other DOMAIN_MIN and DOMAIN_MAX values
+ * are refused.
+ *
+ * returns
+ * -1: malformed file
+ * else the number of entries
+ */
+static int
+text_ramp_read(const unsigned char * data, size_t size, int cube,
+               u_int16_t * table, unsigned int max)
+{
+  size_t i = text_skip(data, size, 0);
+  unsigned int n = 0, c, lut_size = 0;
+  double v;
+
+  while(i < size)
+  {
+    if((data[i] >= 'A' && data[i] <= 'Z') || (data[i] >= 'a' && data[i] <= 'z'))
+    {
+      size_t k = i;
+      if(!cube)
+        return -1;
+      if(size - i > 11 && memcmp(data + i, "LUT_1D_SIZE", 11) == 0)
+      {
+        k = text_skip(data, size, i + 11);
+        if(text_number(data, size, &k, &v) || v < 2 || v > 65536)
+          return -1;
+        lut_size = (unsigned int) v;
+      }
+      else if(size - i > 11 && memcmp(data + i, "LUT_3D_SIZE", 11) == 0)
+        return -1;
+      else if(size - i > 10 && (memcmp(data + i, "DOMAIN_MIN", 10) == 0 ||
+                                memcmp(data + i, "DOMAIN_MAX", 10) == 0))
+      {
+        double expected = data[i + 9] == 'N' ? 0.0 : 1.0;
+        k = i + 10;
+        for(c = 0; c < 3; ++c)
+        {
+          k = text_skip(data, size, k);
+          if(text_number(data, size, &k, &v) || v != expected)
+            return -1;
+        }
+      }
+      while(k < size && data[k] != '\n')
+        ++k;
+      i = text_skip(data, size, k);
+      continue;
+    }
+
+    if(n >= max)
+      return -1;
+    for(c = 0; c < 3; ++c)
+    {
+      if(text_number(data, size, &i, &v))
+        return -1;
+      if(cube)
+        v *= 65535.0;
+      v = v < 0 ? 0 : v > 65535 ? 65535 : v + 0.5;
+      if(table)
+        table[c * max + n] = (u_int16_t) v;
+      i = text_skip(data, size, i);
+    }
+    ++n;
+  }
+
+  if(cube && lut_size && lut_size != n)
+    return -1;
+  return n;
+}
+
+/*
+ * FUNCTION json_ramp_array
+ *
+ * finds "key": [ ... ] in a JSON ramp and reads its numbers into
+ * channel, if not NULL. The text is not 0 terminated, so every step
+ * checks the end.
+ *
+ * returns
+ * -1: key missing or malformed array
+ * else the number of entries
+ */
+static int
+json_ramp_array(const unsigned char * data, size_t size, const char * key,
+                u_int16_t * channel, unsigned int max)
+{
+  size_t key_len = strlen(key), i;
+  unsigned int n = 0;
+
+#define JSON_SKIP_SPACE while(i < size && (data[i] == ' ' || data[i] == '\t' || \
+                                           data[i] == '\n' || data[i] == '\r')) ++i
+  for(i = 0; i + key_len + 2 <= size; ++i)
+    if(data[i] == '"' && data[i + key_len + 1] == '"' &&
+       memcmp(data + i + 1, key, key_len) == 0)
+      break;
+  if(i + key_len + 2 > size)
+    return -1;
+  i += key_len + 2;
+  JSON_SKIP_SPACE;
+  if(i >= size || data[i++] != ':')
+    return -1;
+  JSON_SKIP_SPACE;
+  if(i >= size || data[i++] != '[')
+    return -1;
+  JSON_SKIP_SPACE;
+  if(i < size && data[i] == ']')
+    return 0;
+
+  while(i < size)
+  {
+    unsigned int v = 0, digits = 0;
+
+    JSON_SKIP_SPACE;
+    while(i < size && data[i] >= '0' && data[i] <= '9' && digits < 6)
+    {
+      v = v * 10 + (data[i++] - '0');
+      ++digits;
+    }
+    if(!digits || v > 65535 || n >= max)
+      return -1;
+    if(channel)
+      channel[n] = v;
+    ++n;
+    JSON_SKIP_SPACE;
+    if(i >= size)
+      return -1;
+    if(data[i] == ']')
+      return n;
+    if(data[i++] != ',')
+      return -1;
+  }
+#undef JSON_SKIP_SPACE
+
+  return -1;
+}
+
+/*
+ * FUNCTION ramp_file_read
+ *
+ * reads a ramp file of kind type, see ramp_file_detect(), and resamples
+ * it to nEntries
+ *
+ * returns
+ * -1: corrupt file
+ * 1: success
+ */
+static int
+ramp_file_read(const unsigned char * data, size_t size, int type,
+               const char * filename,
+               u_int16_t * rRamp, u_int16_t * gRamp, u_int16_t * bRamp,
+               unsigned int nEntries)
+{
+  u_int16_t * table = NULL;
+  unsigned int n = 0, j;
+  int ret;
+
+  if(type == RAMP_FILE_BINARY || type == RAMP_FILE_RAW)
+  {
+    const unsigned char * p = data;
+
+    if(type == RAMP_FILE_BINARY)
+    {
+      n = LE_INT(data + 8);
+      if(data[4] != 1 || data[5] != 3 || data[6] != 16 ||
+         (size - RAMP_FILE_HEADER) / 6 < n)
+        n = 0;
+      p += RAMP_FILE_HEADER;
+    }
+    else if(size % 6 == 0)
+      n = size / 6;
+    if(n < 2 || n > 65536)
+    {
+      warning("unsupported or truncated ramp file '%s'", filename);
+      return -1;
+    }
+    table = (u_int16_t *) malloc (3 * n * sizeof (u_int16_t));
+    if(!table)
+      return -1;
+    for(j = 0; j < 3 * n; ++j)
+      table[j] = LE_SHORT(p + 2 * j);
+  }
+  else if(type == RAMP_FILE_JSON)
+  {
+    int r = json_ramp_array(data, size, "red", NULL, 65536),
+        g = json_ramp_array(data, size, "green", NULL, 65536),
+        b = json_ramp_array(data, size, "blue", NULL, 65536);
+
+    if(r < 2 || r != g || r != b)
+    {
+      warning("no red, green and blue arrays of equal size in '%s'", filename);
+      return -1;
+    }
+    n = r;
+    table = (u_int16_t *) malloc (3 * n * sizeof (u_int16_t));
+    if(!table)
+      return -1;
+    json_ramp_array(data, size, "red", table, n);
+    json_ramp_array(data, size, "green", table + n, n);
+    json_ramp_array(data, size, "blue", table + 2 * n, n);
+  }
+  else
+  {
+    int cube = type == RAMP_FILE_CUBE,
+        r = text_ramp_read(data, size, cube, NULL, 65536);
+
+    if(r < 2)
+    {
+      warning("no %s table with 2 - 65536 entries in '%s'",
+              cube ? "1D .cube (DOMAIN 0.0 - 1.0)" : "red green blue", filename);
+      return -1;
+    }
+    n = r;
+    table = (u_int16_t *) malloc (3 * n * sizeof (u_int16_t));
+    if(!table)
+      return -1;
+    text_ramp_read(data, size, cube, table, n);
+  }
+
+  ret = resample_ramps(table, table + n, table + 2 * n, n,
+                       rRamp, gRamp, bRamp, nEntries);
+  free(table);
+
+  return ret;
+}
+
+/*
+ * FUNCTION read_vcgt_internal
+ *
+ * this is a parser for the vcgt tag of ICC profiles which tries to
+ * resemble most of the functionality of Graeme Gill's icclib.
+ * The profile is mapped into memory once and all tables are decoded
+ * directly from there. A vcgt tag is preferred over a mLUT tag.
+ * Ramp files, see ramp_file_detect(), are read without ICC parsing.
+ *
+ * returns
+ * -1: file could not be read
+ * 0: file okay but doesn't contain vcgt or MLUT tag
+ * 1: success
+ */
+static int
+read_vcgt_internal(const char * filename, u_int16_t * rRamp, u_int16_t * gRamp,
+		       u_int16_t * bRamp, unsigned int nEntries,
+		       const xcalib_state_t * state)
+{
+  xcalib_icc_t icc;
+  const xcalib_tag_t * tag;
+  char desc[128];
+  signed int retVal=0;
+  int type;
+
+  if(icc_map_file(filename, &icc))
+    return -1;
+
+  if((type = ramp_file_detect(icc.data, icc.size, filename)) != RAMP_FILE_NONE)
+  {
+    message(state, "ramp file %s", filename);
+    retVal = ramp_file_read(icc.data, icc.size, type, filename, rRamp, gRamp, bRamp, nEntries);
+    icc_unmap_file(&icc);
+    return retVal;
+  }
+
+  if(icc_read_tags(filename, &icc))
+    return -1;
+
+  if(state->verbose && icc_get_description(&icc, desc, sizeof(desc)))
+    message(state, "description:     \t%s", desc);
+
+  if((tag = icc_find_tag(&icc, VCGT_TAG)) != NULL)
+  {
+    message(state, "vcgt found %s", filename);
+    retVal = read_vcgt_tag(&icc, tag, filename, state, rRamp, gRamp, bRamp, nEntries);
+  }
+  else if((tag = icc_find_tag(&icc, MLUT_TAG)) != NULL)
+  {
+    message(state, "mLUT found (Profile Mechanic) %s", filename);
+    retVal = read_mlut_tag(&icc, tag, rRamp, gRamp, bRamp, nEntries);
+  }
+
+  icc_unmap_file(&icc);
+  return retVal;
+}
+
+/*
+ * FUNCTION xcalib_ramp_from_profile
+ *
+ * fills the ramp from the vcgt or mLUT tag of a ICC profile; the tables
+ * are resampled to the ramp size
+ *
+ * returns the same as read_vcgt_internal
+ */
+int
+xcalib_ramp_from_profile(xcalib_ramp_t * ramp, const char * filename,
+                         const xcalib_state_t * state)
+{
+  return read_vcgt_internal(filename, ramp->red, ramp->green, ramp->blue,
+                            ramp->size, state);
+}
+
+/*
+ * FUNCTION hash_fnv1a
+ *
+ * 64-bit FNV-1a hash; pass 0 as h to start a new hash
+ */
+static unsigned long long
+hash_fnv1a(unsigned long long h, const void * data, size_t len)
+{
+  const unsigned char * p = (const unsigned char *) data;
+  size_t i;
+  if(!h)
+    h = 0xcbf29ce484222325ULL;
+  for(i = 0; i < len; ++i)
+  {
+    h ^= p[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+/*
+ * FUNCTION ramp_cache_name
+ *
+ * builds the cache file name for the final ramps of a profile. It is
+ * keyed by the profile ID or, for profiles without ID and for ramp
+ * files, by a hash of the file content plus the ramp size, all
+ * correction parameters and whether the correction is applied at all.
+ *
+ * returns a malloc()ed path or NULL, if the profile can not be read
+ */
+static char *
+ramp_cache_name(const char * dir, const char * filename,
+                unsigned int nEntries, int correction, int invert,
+                const xcalib_state_t * state)
+{
+  xcalib_icc_t icc;
+  unsigned char id[16];
+  unsigned long long h;
+  char * path = NULL;
+  int i, len;
+
+  if(!dir || !dir[0] || icc_map_file(filename, &icc))
+    return NULL;
+  /* bytes 84 - 99 are only a profile ID in ICC profiles */
+  if(ramp_file_detect(icc.data, icc.size, filename) != RAMP_FILE_NONE ||
+     !icc_get_profile_id(&icc, id))
+  {
+    h = hash_fnv1a(0, icc.data, icc.size);
+    memset(id, 0, 16);
+    memcpy(id, &h, sizeof(h));
+  }
+  icc_unmap_file(&icc);
+
+  /* everything which alters the ramps after parsing */
+  h = hash_fnv1a(0, RAMP_CACHE_VERSION, strlen(RAMP_CACHE_VERSION));
+  h = hash_fnv1a(h, &state->redGamma,
+                 sizeof(*state) - offsetof(xcalib_state_t, redGamma));
+  correction = correction != 0;
+  h = hash_fnv1a(h, &correction, sizeof(correction));
+  h = hash_fnv1a(h, &invert, sizeof(invert));
+
+  len = strlen(dir) + 1 + 32 + 1 + 5 + 1 + 16 + 5 + 1;
+  path = (char *) malloc (len);
+  if(!path)
+    return NULL;
+  len = sprintf(path, "%s/", dir);
+  for(i = 0; i < 16; ++i)
+    len += sprintf(&path[len], "%02x", id[i]);
+  sprintf(&path[len], "-%u-%016llx.ramp", nEntries, h);
+
+  return path;
+}
+
+/*
+ * FUNCTION ramp_cache_load
+ *
+ * reads cached ramps of nEntries size
+ *
+ * returns
+ * -1: no valid cache entry
+ * 0: success
+ */
+static int
+ramp_cache_load(const char * path, u_int16_t * rRamp, u_int16_t * gRamp,
+                u_int16_t * bRamp, unsigned int nEntries)
+{
+  xcalib_icc_t file;
+  unsigned int n;
+  size_t plane = nEntries * sizeof(u_int16_t);
+
+  if(icc_map_file(path, &file))
+    return -1;
+  if(file.size != RAMP_CACHE_HEADER + 3 * plane ||
+     memcmp(file.data, RAMP_CACHE_MAGIC, 8) != 0)
+  {
+    icc_unmap_file(&file);
+    return -1;
+  }
+  memcpy(&n, file.data + 8, sizeof(n));
+  if(n != nEntries)
+  {
+    icc_unmap_file(&file);
+    return -1;
+  }
+  memcpy(rRamp, file.data + RAMP_CACHE_HEADER, plane);
+  memcpy(gRamp, file.data + RAMP_CACHE_HEADER + plane, plane);
+  memcpy(bRamp, file.data + RAMP_CACHE_HEADER + 2 * plane, plane);
+  icc_unmap_file(&file);
+
+  return 0;
+}
+
+/*
+ * FUNCTION ramp_cache_save
+ *
+ * stores the final ramps; the directory is created on demand and the
+ * file is written under a temporary name and renamed for concurrent
+ * callers
+ *
+ * returns
+ * -1: error
+ * 0: success
+ */
+static int
+ramp_cache_save(const char * path, const u_int16_t * rRamp,
+                const u_int16_t * gRamp, const u_int16_t * bRamp,
+                unsigned int nEntries)
+{
+  char * tmp = (char *) malloc (strlen(path) + 48);
+  char * slash;
+  unsigned char header[RAMP_CACHE_HEADER];
+  FILE * fp;
+  int ok;
+
+  if(!tmp)
+    return -1;
+
+  /* mkdir -p */
+  strcpy(tmp, path);
+  slash = tmp;
+  while((slash = strchr(slash + 1, '/')) != NULL)
+  {
+    *slash = '\000';
+    MKDIR(tmp);
+    *slash = '/';
+  }
+
+  /* the buffer address keeps concurrent writers in one process apart */
+  sprintf(tmp, "%s.%d.%lx", path, (int)getpid(), (unsigned long)(size_t)tmp);
+  fp = fopen(tmp, "wb");
+  if(!fp)
+  {
+    warning("can not write cache file %s: %s", tmp, strerror(errno));
+    free(tmp);
+    return -1;
+  }
+  memset(header, 0, sizeof(header));
+  memcpy(header, RAMP_CACHE_MAGIC, 8);
+  memcpy(header + 8, &nEntries, sizeof(nEntries));
+  ok = fwrite(header, 1, sizeof(header), fp) == sizeof(header) &&
+       fwrite(rRamp, sizeof(u_int16_t), nEntries, fp) == nEntries &&
+       fwrite(gRamp, sizeof(u_int16_t), nEntries, fp) == nEntries &&
+       fwrite(bRamp, sizeof(u_int16_t), nEntries, fp) == nEntries;
+  if(fclose(fp))
+    ok = 0;
+  if(!ok || rename(tmp, path))
+  {
+    remove(tmp);
+    free(tmp);
+    return -1;
+  }
+  free(tmp);
+
+  return 0;
+}
+
+/*
+ * FUNCTION xcalib_time_ms
+ *
+ * returns a monotonic time stamp in milliseconds
+ */
+double
+xcalib_time_ms(void)
+{
+#ifndef _WIN32
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+#else
+  LARGE_INTEGER count, freq;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&freq);
+  return count.QuadPart * 1000.0 / freq.QuadPart;
+#endif
+}
+
+/*
+ * FUNCTION xcalib_set_correction
+ *
+ * takes the overall gamma, brightness and contrast options into
+ * account; -1.0 brightness and 0.0 gamma or contrast mean unset
+ *
+ * returns 1 if the ramps need correction, otherwise 0
+ */
+int
+xcalib_set_correction(xcalib_state_t * state, double gamma_,
+                      double brightness, double contrast)
+{
+  int correction = 0;
+
+  if(gamma_ != 0.0)
+  {
+    state->gamma_cor = gamma_;
+    if(state->verbose)
+      message(state, "gamma: %f", state->gamma_cor);
+    correction = 1;
+  }
+  /* take additional brightness into account */
+  if (brightness != -1.0) {
+    state->redMin = state->greenMin = state->blueMin = brightness / 100.0;
+    state->redMax = state->greenMax = state->blueMax =
+      (1.0 - state->blueMin) * state->blueMax + state->blueMin;
+    
+    correction = 1;
+  }
+  /* take additional contrast into account */
+  if (contrast != 0.0) {
+    state->redMax = state->greenMax = state->blueMax = contrast / 100.0;
+    state->redMax = state->greenMax = state->blueMax =
+      (1.0 - state->blueMin) * state->blueMax + state->blueMin;
+
+    correction = 1;
+  }
+
+  return correction;
+}
+
+/*
+ * FUNCTION xcalib_ramp_size_supported
+ *
+ * checks for the ramp size being inside the supported range; the
+ * resampler handles any size, not only powers of 2
+ */
+int
+xcalib_ramp_size_supported(unsigned int ramp_size)
+{
+  return ramp_size >= 2 && ramp_size <= 65536;
+}
+
+/*
+ * FUNCTION xcalib_ramp_print_info
+ *
+ * shows brightness and contrast of the ramps in verbose mode
+ */
+void
+xcalib_ramp_print_info(const xcalib_ramp_t * ramp, const xcalib_state_t * state)
+{
+  const u_int16_t * r_ramp = ramp->red, * g_ramp = ramp->green,
+                  * b_ramp = ramp->blue;
+  int ramp_size = ramp->size;
+
+  if(!state->verbose)
+    return;
+
+  {
+    float redBrightness = 0.0;
+    float redContrast = 100.0;
+    float redMin = 0.0;
+    float redMax = 1.0;
+
+    redMin = (double)r_ramp[0] / 65535.0;
+    redMax = (double)r_ramp[ramp_size - 1] / 65535.0;
+    redBrightness = redMin * 100.0;
+    redContrast = (redMax - redMin) / (1.0 - redMin) * 100.0; 
+    message(state, "Red Brightness: %f   Contrast: %f  Max: %f  Min: %f", redBrightness, redContrast, redMax, redMin);
+  }
+
+  {
+    float greenBrightness = 0.0;
+    float greenContrast = 100.0;
+    float greenMin = 0.0;
+    float greenMax = 1.0;
+
+    greenMin = (double)g_ramp[0] / 65535.0;
+    greenMax = (double)g_ramp[ramp_size - 1] / 65535.0;
+    greenBrightness = greenMin * 100.0;
+    greenContrast = (greenMax - greenMin) / (1.0 - greenMin) * 100.0; 
+    message(state, "Green Brightness: %f   Contrast: %f  Max: %f  Min: %f", greenBrightness, greenContrast, greenMax, greenMin);
+  }
+
+  {
+    float blueBrightness = 0.0;
+    float blueContrast = 100.0;
+    float blueMin = 0.0;
+    float blueMax = 1.0;
+
+    blueMin = (double)b_ramp[0] / 65535.0;
+    blueMax = (double)b_ramp[ramp_size - 1] / 65535.0;
+    blueBrightness = blueMin * 100.0;
+    blueContrast = (blueMax - blueMin) / (1.0 - blueMin) * 100.0; 
+    message(state, "Blue Brightness: %f   Contrast: %f  Max: %f  Min: %f", blueBrightness, blueContrast, blueMax, blueMin);
+  }
+}
+
+/*
+ * FUNCTION correct_channel
+ *
+ * maps one channel through 65536 * (x^gamma * (max - min) + min).
+ * Runs of equal entries, as in ramps scaled up from a smaller vcgt,
+ * reuse the previous result instead of calling pow() again. The
+ * arithmetic per entry is unchanged, so the result is bit identical to
+ * calling pow() for every entry.
+ */
+static void
+correct_channel(u_int16_t * ramp, int ramp_size, double gamma_,
+                float min, float max)
+{
+  u_int16_t last_in = 0, last_out = 0;
+  int i;
+
+  for(i=0; i<ramp_size; i++)
+  {
+    if(i && ramp[i] == last_in)
+    {
+      ramp[i] = last_out;
+      continue;
+    }
+    last_in = ramp[i];
+    ramp[i] = 65536.0 * (((double) pow (((double) ramp[i]/65536.0), gamma_
+                ) * (max - min)) + min);
+    last_out = ramp[i];
+  }
+}
+
+/*
+ * FUNCTION xcalib_ramp_correct
+ *
+ * applies gamma, brightness and contrast from state.
+ * A channel with the same entries and parameters as red is copied.
+ */
+void
+xcalib_ramp_correct(xcalib_ramp_t * ramp, const xcalib_state_t * state)
+{
+  u_int16_t * r_ramp = ramp->red, * g_ramp = ramp->green, * b_ramp = ramp->blue;
+  int ramp_size = ramp->size;
+  size_t size = ramp_size * sizeof (u_int16_t);
+  int g_same = state->greenGamma == state->redGamma &&
+               state->greenMin == state->redMin &&
+               state->greenMax == state->redMax &&
+               memcmp(g_ramp, r_ramp, size) == 0;
+  int b_same = state->blueGamma == state->redGamma &&
+               state->blueMin == state->redMin &&
+               state->blueMax == state->redMax &&
+               memcmp(b_ramp, r_ramp, size) == 0;
+
+  correct_channel(r_ramp, ramp_size,
+                  state->redGamma * (double) state->gamma_cor,
+                  state->redMin, state->redMax);
+  if(g_same)
+    memcpy(g_ramp, r_ramp, size);
+  else
+    correct_channel(g_ramp, ramp_size,
+                    state->greenGamma * (double) state->gamma_cor,
+                    state->greenMin, state->greenMax);
+  if(b_same)
+    memcpy(b_ramp, r_ramp, size);
+  else
+    correct_channel(b_ramp, ramp_size,
+                    state->blueGamma * (double) state->gamma_cor,
+                    state->blueMin, state->blueMax);
+  message(state, "Altering Red LUTs with   Gamma %f   Min %f   Max %f",
+     state->redGamma, state->redMin, state->redMax);
+  message(state, "Altering Green LUTs with   Gamma %f   Min %f   Max %f",
+     state->greenGamma, state->greenMin, state->greenMax);
+  message(state, "Altering Blue LUTs with   Gamma %f   Min %f   Max %f",
+     state->blueGamma, state->blueMin, state->blueMax);
+}
+
+/*
+ * FUNCTION xcalib_ramp_invert
+ *
+ * inverts the ramps or, without invert, checks them for being increasing
+ */
+void
+xcalib_ramp_invert(xcalib_ramp_t * ramp, int invert)
+{
+  u_int16_t * r_ramp = ramp->red, * g_ramp = ramp->green, * b_ramp = ramp->blue;
+  int ramp_size = ramp->size;
+  u_int16_t tmpRampVal = 0;
+  int i;
+
+  if(!invert) {
+    /* ramps should be increasing - otherwise content is nonsense! */
+    for (i = 0; i < ramp_size - 1; i++) {
+      if (r_ramp[i + 1] < r_ramp[i])
+        warning ("red gamma table not increasing [%d]%d %d", i, r_ramp[i], r_ramp[i + 1]);
+      if (g_ramp[i + 1] < g_ramp[i])
+        warning ("green gamma table not increasing [%d]%d %d", i, r_ramp[i], r_ramp[i + 1]);
+      if (b_ramp[i + 1] < b_ramp[i])
+        warning ("blue gamma table not increasing [%d]%d %d", i, r_ramp[i], r_ramp[i + 1]);
+    }
+  } else {
+    for (i = 0; i < ramp_size; i++) {
+      if(i >= ramp_size / 2)
+        break;
+      tmpRampVal = r_ramp[i];
+      r_ramp[i] = r_ramp[ramp_size - i - 1];
+      r_ramp[ramp_size - i - 1] = tmpRampVal;
+      tmpRampVal = g_ramp[i];
+      g_ramp[i] = g_ramp[ramp_size - i - 1];
+      g_ramp[ramp_size - i - 1] = tmpRampVal;
+      tmpRampVal = b_ramp[i];
+      b_ramp[i] = b_ramp[ramp_size - i - 1];
+      b_ramp[ramp_size - i - 1] = tmpRampVal;
+    }
+  }
+}
+
+/*
+ * FUNCTION loss_channel
+ *
+ * counts the entries which do not start a new 8-bit level
+ */
+static unsigned int
+loss_channel(const u_int16_t * channel, unsigned int n)
+{
+  unsigned int i, levels = 0;
+  u_int16_t last = 0xffff;
+
+  for(i = 0; i < n; ++i)
+  {
+    if((channel[i] & 0xff00) != (last & 0xff00))
+      ++levels;
+    last = channel[i];
+  }
+
+  return n - levels;
+}
+
+/*
+ * FUNCTION xcalib_ramp_loss
+ *
+ * computes the resolution loss of a ramp on a 8-bit display path: the
+ * number of entries per channel which give no new 8-bit value
+ */
+void
+xcalib_ramp_loss(const xcalib_ramp_t * ramp, unsigned int lost[3])
+{
+  lost[0] = loss_channel(ramp->red, ramp->size);
+  lost[1] = loss_channel(ramp->green, ramp->size);
+  lost[2] = loss_channel(ramp->blue, ramp->size);
+}
+
+/*
+ * FUNCTION xcalib_ramp_load
+ *
+ * fills the ramp from a ICC profile, applies correction and inversion
+ * and maintains the ramp cache, if cache_dir is set
+ *
+ * returns the same as xcalib_ramp_from_profile
+ */
+int
+xcalib_ramp_load(xcalib_ramp_t * ramp, const char * filename,
+                 const char * cache_dir, int correction, int invert,
+                 const xcalib_state_t * state)
+{
+  char * cache_file = NULL;
+  int ret;
+
+  if(cache_dir && cache_dir[0])
+    cache_file = ramp_cache_name(cache_dir, filename, ramp->size,
+                                 correction, invert, state);
+  if(cache_file && ramp_cache_load(cache_file, ramp->red, ramp->green, ramp->blue, ramp->size) == 0)
+  {
+    message(state, "cached ramps:    \t%s", cache_file);
+    free(cache_file);
+    return 1;
+  }
+
+  ret = xcalib_ramp_from_profile(ramp, filename, state);
+  if(ret <= 0)
+  {
+    free(cache_file);
+    return ret;
+  }
+
+  xcalib_ramp_print_info(ramp, state);
+  if(correction != 0)
+    xcalib_ramp_correct(ramp, state);
+  xcalib_ramp_invert(ramp, invert);
+
+  if(cache_file)
+  {
+    if(ramp_cache_save(cache_file, ramp->red, ramp->green, ramp->blue, ramp->size) == 0)
+      message(state, "cache written:   \t%s", cache_file);
+    free(cache_file);
+  }
+
+  return ret;
+}
+
+/* buffered writer for the ramp export; text goes out in large fwrite()s */
+typedef struct {
+  FILE * fp;
+  size_t len;
+  int error;
+  char buf[16384];
+} export_buf_t;
+
+/*
+ * FUNCTION export_put
+ *
+ * appends n bytes to the export buffer, flushing it when full
+ */
+static void
+export_put(export_buf_t * eb, const char * text, size_t n)
+{
+  if(eb->len + n > sizeof(eb->buf))
+  {
+    if(eb->len && fwrite(eb->buf, 1, eb->len, eb->fp) != eb->len)
+      eb->error = 1;
+    eb->len = 0;
+    if(n > sizeof(eb->buf))
+    {
+      if(fwrite(text, 1, n, eb->fp) != n)
+        eb->error = 1;
+      return;
+    }
+  }
+  memcpy(eb->buf + eb->len, text, n);
+  eb->len += n;
+}
+
+/*
+ * FUNCTION export_uint
+ *
+ * writes a decimal number without going through printf
+ */
+static void
+export_uint(export_buf_t * eb, unsigned int v)
+{
+  char digits[16];
+  int n = sizeof(digits);
+
+  do {
+    digits[--n] = '0' + v % 10;
+    v /= 10;
+  } while(v);
+  export_put(eb, digits + n, sizeof(digits) - n);
+}
+
+/*
+ * FUNCTION export_double
+ *
+ * writes v as %g with a dot as decimal separator in any locale, without
+ * touching the process wide locale
+ */
+static void
+export_double(export_buf_t * eb, double v)
+{
+  char text[32];
+  int i, n = snprintf(text, sizeof(text), "%g", v);
+
+  if(n <= 0 || n >= (int)sizeof(text))
+    return;
+  for(i = 0; i < n; ++i)
+    if(text[i] == ',')
+      text[i] = '.';
+  export_put(eb, text, n);
+}
+
+#define export_string(eb, text) export_put(eb, text, sizeof(text) - 1)
+
+/*
+ * FUNCTION export_svg_curve
+ *
+ * writes one channel as SVG path
+ */
+static void
+export_svg_curve(export_buf_t * eb, const u_int16_t * channel,
+                 unsigned int size, const char * color)
+{
+  unsigned int i;
+
+  export_string(eb, "<path fill=\"none\" stroke-width=\"4\" stroke-linecap=\"butt\" stroke-linejoin=\"miter\" stroke=\"");
+  export_put(eb, color, strlen(color));
+  export_string(eb, "\" d=\"");
+  for(i = 0; i < size; ++i)
+  {
+    export_put(eb, i == 0 ? "M " : "L ", 2);
+    export_double(eb, 51.5 + (973.5-51.5) / size * i);
+    export_put(eb, " ", 1);
+    export_double(eb, 973.5 - channel[i]/65535.0 * (973.5-51.5));
+    export_put(eb, " ", 1);
+  }
+  export_string(eb, " \"/>\n");
+}
+
+/*
+ * FUNCTION export_plane
+ *
+ * writes one channel as 16-bit little endian values
+ */
+static void
+export_plane(export_buf_t * eb, const u_int16_t * channel, unsigned int size)
+{
+  unsigned char le[512];
+  unsigned int i, j;
+
+  for(i = 0; i < size; i += j)
+  {
+    for(j = 0; j < sizeof(le) / 2 && i + j < size; ++j)
+    {
+      le[2 * j] = channel[i + j] & 0xff;
+      le[2 * j + 1] = channel[i + j] >> 8;
+    }
+    export_put(eb, (const char *) le, 2 * j);
+  }
+}
+
+/*
+ * FUNCTION export_json_array
+ *
+ * writes one channel as JSON array member
+ */
+static void
+export_json_array(export_buf_t * eb, const char * key,
+                  const u_int16_t * channel, unsigned int size, int last)
+{
+  unsigned int i;
+
+  export_string(eb, "  \"");
+  export_put(eb, key, strlen(key));
+  export_string(eb, "\": [");
+  for(i = 0; i < size; ++i)
+  {
+    if(i)
+      export_put(eb, ",", 1);
+    export_uint(eb, channel[i]);
+  }
+  if(last)
+    export_string(eb, "]\n");
+  else
+    export_string(eb, "],\n");
+}
+
+/*
+ * FUNCTION xcalib_ramp_print
+ *
+ * writes the ramp to fp; format is "TEXT" for one line of red, green
+ * and blue per entry, "SVG" for a plot of the three curves, "JSON" or
+ * "BINARY". JSON and BINARY files are accepted as input by
+ * xcalib_ramp_from_profile(). The output is streamed in blocks, so the
+ * cost grows linear with the ramp size.
+ *
+ * returns
+ * -1: unknown format or write error
+ * 0: success
+ */
+int
+xcalib_ramp_print(const xcalib_ramp_t * ramp, const char * format, FILE * fp)
+{
+  export_buf_t * eb;
+  unsigned int i;
+  int type;
+
+  if(!format || strcasecmp(format, "TEXT") == 0)
+    type = 0;
+  else if(strcasecmp(format, "SVG") == 0)
+    type = 1;
+  else if(strcasecmp(format, "JSON") == 0)
+    type = 2;
+  else if(strcasecmp(format, "BINARY") == 0)
+    type = 3;
+  else
+    return -1;
+
+  eb = (export_buf_t *) malloc(sizeof(export_buf_t));
+  if(!eb)
+    return -1;
+  eb->fp = fp;
+  eb->len = 0;
+  eb->error = 0;
+
+  if(type == 3)
+  {
+    unsigned char header[RAMP_FILE_HEADER] = {0};
+
+    memcpy(header, XCALIB_RAMP_MAGIC, 4);
+    header[4] = 1;  /* version */
+    header[5] = 3;  /* channels */
+    header[6] = 16; /* bits */
+    for(i = 0; i < 4; ++i)
+      header[8 + i] = (ramp->size >> (8 * i)) & 0xff;
+    export_put(eb, (const char *) header, sizeof(header));
+    export_plane(eb, ramp->red, ramp->size);
+    export_plane(eb, ramp->green, ramp->size);
+    export_plane(eb, ramp->blue, ramp->size);
+  }
+  else if(type == 2)
+  {
+    export_string(eb, "{\n  \"size\": ");
+    export_uint(eb, ramp->size);
+    export_string(eb, ",\n  \"bits\": 16,\n");
+    export_json_array(eb, "red", ramp->red, ramp->size, 0);
+    export_json_array(eb, "green", ramp->green, ramp->size, 0);
+    export_json_array(eb, "blue", ramp->blue, ramp->size, 1);
+    export_string(eb, "}\n");
+  }
+  else if(type == 1)
+  {
+    export_string(eb, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    /* header */
+    export_string(eb, "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" width=\"1024\" height=\"1024\" viewBox=\"0 0 1024 1024\">\n");
+    /* background rectangle */
+    export_string(eb, "<rect x=\"-102.4\" y=\"-102.4\" width=\"1228.8\" height=\"1228.8\" fill=\"rgb(67.08324%, 67.07561%, 67.084765%)\" fill-opacity=\"0.5\"/>\n");
+    /* add frame */
+    export_string(eb, "<path fill=\"none\" stroke-width=\"5.6\" stroke=\"rgb(0%, 0%, 0%)\" d=\"M 25.398438 25.398438 L 998.199219 25.398438 L 998.199219 998.199219 L 25.398438 998.199219 Z M 25.398438 25.398438 \"/>\n");
+    export_svg_curve(eb, ramp->red, ramp->size, "rgb(100%, 0%, 0%)");
+    export_svg_curve(eb, ramp->green, ramp->size, "rgb(0%, 100%, 0%)");
+    export_svg_curve(eb, ramp->blue, ramp->size, "rgb(0%, 0%, 100%)");
+    export_string(eb, "</svg>\n");
+  }
+  else
+  {
+    for(i = 0; i < ramp->size; ++i)
+    {
+      export_uint(eb, ramp->red[i]);
+      export_put(eb, " ", 1);
+      export_uint(eb, ramp->green[i]);
+      export_put(eb, " ", 1);
+      export_uint(eb, ramp->blue[i]);
+      export_put(eb, "\n", 1);
+    }
+  }
+
+  if(eb->len && fwrite(eb->buf, 1, eb->len, fp) != eb->len)
+    eb->error = 1;
+  i = eb->error;
+  free(eb);
+
+  return i ? -1 : 0;
+}
+
+#ifndef _WIN32
+/* replies waited for by the xcalib_xrr_* calls of all threads */
+static unsigned long xrr_round_trips = 0;
+
+/*
+ * FUNCTION count_round_trips
+ *
+ * adds n blocking waits for the X server to the counter
+ */
+static void
+count_round_trips(unsigned long n)
+{
+#if defined(__GNUC__)
+  __sync_fetch_and_add(&xrr_round_trips, n);
+#else
+  xrr_round_trips += n;
+#endif
+}
+
+/*
+ * FUNCTION xcalib_xrr_round_trips
+ *
+ * returns the number of round trips, for which the xcalib_xrr_* calls
+ * waited, since program start. The XCB backend counts a pipelined
+ * batch of requests once.
+ */
+unsigned long
+xcalib_xrr_round_trips(void)
+{
+  return xrr_round_trips;
+}
+
+#ifdef HAVE_XCB
+/*
+ * FUNCTION xcb_get_resources
+ *
+ * copies the output and CRTC ids of the screen resources in one
+ * round trip; *outputs holds both, the CRTCs behind the outputs
+ *
+ * returns 0 on success, otherwise -1
+ */
+static int
+xcb_get_resources(xcb_connection_t * c, xcb_window_t root, int xrr_version,
+                  xcb_randr_output_t ** outputs, int * noutputs,
+                  xcb_randr_crtc_t ** crtcs, int * ncrtcs,
+                  xcb_timestamp_t * config_timestamp)
+{
+  const xcb_randr_output_t * o;
+  const xcb_randr_crtc_t * r;
+  void * reply;
+
+  count_round_trips(1);
+  if(xrr_version >= 103)
+  {
+    xcb_randr_get_screen_resources_current_reply_t * res =
+      xcb_randr_get_screen_resources_current_reply( c,
+                   xcb_randr_get_screen_resources_current( c, root ), NULL );
+    if(!res)
+      return -1;
+    o = xcb_randr_get_screen_resources_current_outputs( res );
+    *noutputs = xcb_randr_get_screen_resources_current_outputs_length( res );
+    r = xcb_randr_get_screen_resources_current_crtcs( res );
+    *ncrtcs = xcb_randr_get_screen_resources_current_crtcs_length( res );
+    *config_timestamp = res->config_timestamp;
+    reply = res;
+  }
+  else
+  {
+    xcb_randr_get_screen_resources_reply_t * res =
+      xcb_randr_get_screen_resources_reply( c,
+                   xcb_randr_get_screen_resources( c, root ), NULL );
+    if(!res)
+      return -1;
+    o = xcb_randr_get_screen_resources_outputs( res );
+    *noutputs = xcb_randr_get_screen_resources_outputs_length( res );
+    r = xcb_randr_get_screen_resources_crtcs( res );
+    *ncrtcs = xcb_randr_get_screen_resources_crtcs_length( res );
+    *config_timestamp = res->config_timestamp;
+    reply = res;
+  }
+
+  *outputs = (xcb_randr_output_t *) malloc ((*noutputs + *ncrtcs + 1) * sizeof (uint32_t));
+  if(*outputs)
+  {
+    *crtcs = (xcb_randr_crtc_t *) (*outputs + *noutputs);
+    memcpy( *outputs, o, *noutputs * sizeof (xcb_randr_output_t) );
+    memcpy( *crtcs, r, *ncrtcs * sizeof (xcb_randr_crtc_t) );
+  }
+  free( reply );
+
+  return *outputs ? 0 : -1;
+}
+
+/*
+ * FUNCTION xrr_get_outputs
+ *
+ * XCB variant: sends the output info and the gamma size requests for
+ * all outputs and CRTCs back to back and collects the replies
+ * afterwards. That needs two round trips independent of the number
+ * of outputs.
+ *
+ * returns the number of active outputs; *outputs is malloc()ed
+ */
+static int
+xrr_get_outputs(void * data, int screen, int xrr_version,
+                xcalib_output_t ** outputs)
+{
+  Display * dpy = (Display*) data;
+  xcb_connection_t * c = XGetXCBConnection( dpy );
+  xcb_window_t root = RootWindow( dpy, screen );
+  xcb_randr_output_t * ids = NULL;
+  xcb_randr_crtc_t * crtcs = NULL;
+  xcb_randr_get_output_info_cookie_t * info_cookies = NULL;
+  xcb_randr_get_crtc_gamma_size_cookie_t * size_cookies = NULL;
+  xcb_timestamp_t config_timestamp = 0;
+  xcalib_output_t * list = NULL;
+  int * sizes = NULL;
+  int i, j, n = 0, nids = 0, ncrtcs = 0;
+
+  *outputs = NULL;
+  if(xcb_get_resources( c, root, xrr_version, &ids, &nids, &crtcs, &ncrtcs, &config_timestamp ))
+    return 0;
+
+  info_cookies = (xcb_randr_get_output_info_cookie_t *) malloc ((nids + 1) * sizeof (*info_cookies));
+  size_cookies = (xcb_randr_get_crtc_gamma_size_cookie_t *) malloc ((ncrtcs + 1) * sizeof (*size_cookies));
+  sizes = (int *) calloc (ncrtcs + 1, sizeof (int));
+  if(nids)
+    list = (xcalib_output_t *) calloc (nids, sizeof (xcalib_output_t));
+  if(!info_cookies || !size_cookies || !sizes || !list)
+    nids = ncrtcs = 0;
+
+  for( i = 0; i < nids; ++i )
+    info_cookies[i] = xcb_randr_get_output_info( c, ids[i], config_timestamp );
+  for( j = 0; j < ncrtcs; ++j )
+    size_cookies[j] = xcb_randr_get_crtc_gamma_size( c, crtcs[j] );
+  if(nids || ncrtcs)
+    count_round_trips(1);
+
+  for( j = 0; j < ncrtcs; ++j )
+  {
+    xcb_randr_get_crtc_gamma_size_reply_t * size =
+      xcb_randr_get_crtc_gamma_size_reply( c, size_cookies[j], NULL );
+    if(size)
+      sizes[j] = size->size;
+    free( size );
+  }
+  for( i = 0; i < nids; ++i )
+  {
+    xcb_randr_get_output_info_reply_t * output_info =
+      xcb_randr_get_output_info_reply( c, info_cookies[i], NULL );
+    if(!output_info)
+      continue;
+    if(output_info->crtc)
+    {
+      list[n].output = ids[i];
+      list[n].crtc = output_info->crtc;
+      for( j = 0; j < ncrtcs; ++j )
+        if(crtcs[j] == output_info->crtc)
+          list[n].gamma_size = sizes[j];
+      snprintf(list[n].name, sizeof(list[n].name), "%.*s",
+               xcb_randr_get_output_info_name_length( output_info ),
+               (const char *) xcb_randr_get_output_info_name( output_info ));
+      ++n;
+    }
+    free( output_info );
+  }
+
+  free( sizes );
+  free( size_cookies );
+  free( info_cookies );
+  free( ids );
+  if(!n)
+  {
+    free( list );
+    list = NULL;
+  }
+
+  *outputs = list;
+  return n;
+}
+#else
+/*
+ * FUNCTION xrr_get_outputs
+ *
+ * queries the screen resources once and lists all outputs with a
+ * CRTC together with the CRTC gamma size. With XRandR 1.3 the current
+ * resources are used, which avoids a hardware probe of all connectors.
+ *
+ * returns the number of active outputs; *outputs is malloc()ed
+ */
+static int
+xrr_get_outputs(void * data, int screen, int xrr_version,
+                xcalib_output_t ** outputs)
+{
+  Display * dpy = (Display*) data;
+  Window root = RootWindow( dpy, screen );
+  XRRScreenResources * res;
+  xcalib_output_t * list = NULL;
+  int i, n = 0;
+
+  if(xrr_version >= 103)
+    res = XRRGetScreenResourcesCurrent( dpy, root );
+  else
+    res = XRRGetScreenResources( dpy, root );
+  count_round_trips(1);
+
+  *outputs = NULL;
+  if(!res)
+    return 0;
+
+  if(res->noutput)
+    list = (xcalib_output_t *) calloc (res->noutput, sizeof (xcalib_output_t));
+  for( i = 0; list && i < res->noutput; ++i )
+  {
+    XRROutputInfo * output_info = XRRGetOutputInfo( dpy, res, res->outputs[i] );
+    count_round_trips(1);
+    if(!output_info)
+      continue;
+    if(output_info->crtc)
+    {
+      list[n].output = res->outputs[i];
+      list[n].crtc = output_info->crtc;
+      list[n].gamma_size = XRRGetCrtcGammaSize( dpy, output_info->crtc );
+      count_round_trips(1);
+      snprintf(list[n].name, sizeof(list[n].name), "%s", output_info->name);
+      ++n;
+    }
+    XRRFreeOutputInfo( output_info ); output_info = 0;
+  }
+  XRRFreeScreenResources( res ); res = 0;
+
+  *outputs = list;
+  return n;
+}
+
+#endif /* HAVE_XCB */
+
+/*
+ * FUNCTION xcalib_xrr_find_output
+ *
+ * looks up a output by its index among the active outputs or by name
+ *
+ * returns the output or NULL
+ */
+xcalib_output_t *
+xcalib_xrr_find_output(xcalib_output_t * outputs, int n, const char * output)
+{
+  const char * end = NULL;
+  long index = 0;
+  int i;
+
+  if(!output || !output[0])
+    return n ? &outputs[0] : NULL;
+
+  index = strtol(output, (char**)&end, 10);
+  if(end && end != output && !end[0])
+    return (index >= 0 && index < n) ? &outputs[index] : NULL;
+
+  for(i = 0; i < n; ++i)
+    if(strcmp(outputs[i].name, output) == 0)
+      return &outputs[i];
+
+  return NULL;
+}
+
+#ifdef HAVE_XCB
+/*
+ * FUNCTION xcb_get_gamma
+ *
+ * fetches the CRTC gamma; the reply is malloc()ed
+ */
+static xcb_randr_get_crtc_gamma_reply_t *
+xcb_get_gamma(xcb_connection_t * c, RRCrtc crtc)
+{
+  count_round_trips(1);
+  return xcb_randr_get_crtc_gamma_reply( c, xcb_randr_get_crtc_gamma( c, crtc ), NULL );
+}
+
+/*
+ * FUNCTION xrr_ramp_equal
+ *
+ * reads back the current CRTC gamma and compares it to the ramp
+ *
+ * returns 1 if the CRTC holds already the same ramp, otherwise 0
+ */
+static int
+xrr_ramp_equal(void * data, RRCrtc crtc, const xcalib_ramp_t * ramp)
+{
+  xcb_connection_t * c = XGetXCBConnection( (Display*) data );
+  xcb_randr_get_crtc_gamma_reply_t * current =
+    xcb_get_gamma( c, crtc );
+  size_t size = ramp->size * sizeof (u_int16_t);
+  int equal;
+
+  equal = current && current->size == ramp->size &&
+          memcmp( xcb_randr_get_crtc_gamma_red( current ), ramp->red, size ) == 0 &&
+          memcmp( xcb_randr_get_crtc_gamma_green( current ), ramp->green, size ) == 0 &&
+          memcmp( xcb_randr_get_crtc_gamma_blue( current ), ramp->blue, size ) == 0;
+  free( current );
+
+  return equal;
+}
+
+/*
+ * FUNCTION xrr_get
+ *
+ * reads the current CRTC gamma into ramp
+ *
+ * returns 0 on success, -1 on error or if the sizes differ
+ */
+static int
+xrr_get(void * data, RRCrtc crtc, xcalib_ramp_t * ramp)
+{
+  xcb_connection_t * c = XGetXCBConnection( (Display*) data );
+  xcb_randr_get_crtc_gamma_reply_t * current =
+    xcb_get_gamma( c, crtc );
+  size_t size = ramp->size * sizeof (u_int16_t);
+  int ret = -1;
+
+  if(current && current->size == ramp->size)
+  {
+    memcpy( ramp->red, xcb_randr_get_crtc_gamma_red( current ), size );
+    memcpy( ramp->green, xcb_randr_get_crtc_gamma_green( current ), size );
+    memcpy( ramp->blue, xcb_randr_get_crtc_gamma_blue( current ), size );
+    ret = 0;
+  }
+  free( current );
+
+  return ret;
+}
+
+/*
+ * FUNCTION xrr_set
+ *
+ * uploads the ramp to a CRTC without reading the current one back.
+ * It does not wait for a reply; errors are reported through the Xlib
+ * error handler as with XRRSetCrtcGamma().
+ *
+ * returns 0 on success, otherwise -1
+ */
+static int
+xrr_set(void * data, RRCrtc crtc, const xcalib_ramp_t * ramp)
+{
+  xcb_connection_t * c = XGetXCBConnection( (Display*) data );
+
+  xcb_randr_set_crtc_gamma( c, crtc, ramp->size, ramp->red, ramp->green, ramp->blue );
+
+  return xcb_flush( c ) > 0 ? 0 : -1;
+}
+
+#else
+/*
+ * FUNCTION xrr_get_gamma
+ *
+ * fetches the CRTC gamma; free with XRRFreeGamma()
+ */
+static XRRCrtcGamma *
+xrr_get_gamma(Display * dpy, RRCrtc crtc)
+{
+  count_round_trips(1);
+  return XRRGetCrtcGamma( dpy, crtc );
+}
+
+/*
+ * FUNCTION xrr_ramp_equal
+ *
+ * reads back the current CRTC gamma and compares it to the ramp
+ *
+ * returns 1 if the CRTC holds already the same ramp, otherwise 0
+ */
+static int
+xrr_ramp_equal(void * data, RRCrtc crtc, const xcalib_ramp_t * ramp)
+{
+  XRRCrtcGamma * current = xrr_get_gamma( (Display*) data, crtc );
+  size_t size = ramp->size * sizeof (u_int16_t);
+  int equal;
+
+  equal = current && current->size == (int)ramp->size &&
+          memcmp( current->red, ramp->red, size ) == 0 &&
+          memcmp( current->green, ramp->green, size ) == 0 &&
+          memcmp( current->blue, ramp->blue, size ) == 0;
+
+  if(current)
+    XRRFreeGamma( current );
+
+  return equal;
+}
+
+/*
+ * FUNCTION xrr_get
+ *
+ * reads the current CRTC gamma into ramp
+ *
+ * returns 0 on success, -1 on error or if the sizes differ
+ */
+static int
+xrr_get(void * data, RRCrtc crtc, xcalib_ramp_t * ramp)
+{
+  XRRCrtcGamma * current = xrr_get_gamma( (Display*) data, crtc );
+  size_t size = ramp->size * sizeof (u_int16_t);
+  int ret = -1;
+
+  if(current && current->size == (int)ramp->size)
+  {
+    memcpy( ramp->red, current->red, size );
+    memcpy( ramp->green, current->green, size );
+    memcpy( ramp->blue, current->blue, size );
+    ret = 0;
+  }
+  if(current)
+    XRRFreeGamma( current );
+
+  return ret;
+}
+
+/*
+ * FUNCTION xrr_set
+ *
+ * uploads the ramp to a CRTC without reading the current one back
+ *
+ * returns 0 on success, otherwise -1
+ */
+static int
+xrr_set(void * data, RRCrtc crtc, const xcalib_ramp_t * ramp)
+{
+  XRRCrtcGamma * gamma = XRRAllocGamma (ramp->size);
+
+  if(!gamma)
+    return -1;
+
+  memcpy( gamma->red, ramp->red, ramp->size * sizeof (u_int16_t) );
+  memcpy( gamma->green, ramp->green, ramp->size * sizeof (u_int16_t) );
+  memcpy( gamma->blue, ramp->blue, ramp->size * sizeof (u_int16_t) );
+  XRRSetCrtcGamma ((Display*) data, crtc, gamma);
+  XRRFreeGamma (gamma);
+
+  return 0;
+}
+#endif /* HAVE_XCB */
+
+/*
+ * FUNCTION xrr_sync
+ *
+ * waits until the server processed all requests
+ */
+static void
+xrr_sync(void * data)
+{
+  XSync( (Display*) data, False );
+  count_round_trips(1);
+}
+
+static int
+xrr_version(void * data)
+{
+  int major = 0, minor = 0;
+
+  count_round_trips(1);
+  if(!XRRQueryVersion( (Display*) data, &major, &minor ))
+    return 0;
+  return major*100 + minor;
+}
+
+static void
+xrr_close(void * data)
+{
+  XCloseDisplay( (Display*) data );
+  count_round_trips(1);
+}
+
+static const xcalib_backend_t xrr_backend = {
+  xrr_version, xrr_get_outputs, xrr_ramp_equal, xrr_get, xrr_set, xrr_sync,
+  xrr_close
+};
+
+/* the handle behind xcalib_display_t */
+struct xcalib_display_s {
+  const xcalib_backend_t * backend;
+  void * data;                         /* of the backend */
+  Display * x11;                       /* NULL without X connection */
+  char * name;
+  unsigned long requests;              /* backend calls */
+};
+
+/*
+ * FUNCTION sleep_until
+ *
+ * waits until the xcalib_time_ms() time stamp due
+ */
+static void
+sleep_until(double due)
+{
+  double wait = due - xcalib_time_ms();
+  struct timespec ts;
+
+  if(wait <= 0.0)
+    return;
+  ts.tv_sec = (time_t)(wait / 1000.0);
+  ts.tv_nsec = (long)((wait - ts.tv_sec * 1000.0) * 1000000.0);
+  while(nanosleep( &ts, &ts ) != 0 && errno == EINTR)
+    ;
+}
+
+/* The data of a virtual display. The CRTC ids are 1 ... n, the output
+ * ids 0x100 + index. */
+#define VIRTUAL_PREFIX "virtual:"
+#define VIRTUAL_MAX_OUTPUTS 16
+
+typedef struct {
+  char * name;
+  int n;
+  xcalib_ramp_t * ramps[VIRTUAL_MAX_OUTPUTS];
+  double latency_ms;                   /* per reply */
+  double start;                        /* open time */
+  xcalib_virtual_write_t * writes;
+  int nwrites;
+  int writes_reserved;
+} xcalib_virtual_t;
+
+/*
+ * FUNCTION virtual_request
+ *
+ * waits for a request with reply the simulated latency
+ */
+static void
+virtual_request(xcalib_virtual_t * v, int reply)
+{
+  if(!reply)
+    return;
+  count_round_trips(1);
+  if(v->latency_ms > 0.0)
+    sleep_until( xcalib_time_ms() + v->latency_ms );
+}
+
+/*
+ * FUNCTION virtual_crtc
+ *
+ * returns the ramp held by a virtual CRTC or NULL
+ */
+static xcalib_ramp_t *
+virtual_crtc(xcalib_virtual_t * v, RRCrtc crtc)
+{
+  return crtc >= 1 && crtc <= (RRCrtc)v->n ? v->ramps[crtc - 1] : NULL;
+}
+
+/*
+ * FUNCTION virtual_close
+ *
+ * appends the writes to the file named by XCALIB_VIRTUAL_LOG and
+ * frees the virtual display
+ */
+static void
+virtual_close(void * data)
+{
+  xcalib_virtual_t * v = (xcalib_virtual_t*) data;
+  const char * log = getenv("XCALIB_VIRTUAL_LOG");
+  int i;
+
+  if(log && log[0] && v->nwrites)
+  {
+    FILE * fp = fopen( log, "a" );
+    if(fp)
+    {
+      for(i = 0; i < v->nwrites; ++i)
+        fprintf( fp, "%s crtc %lu size %u at %.3f ms hash %016llx\n",
+                 v->name, (unsigned long)v->writes[i].crtc,
+                 v->writes[i].size, v->writes[i].ms, v->writes[i].hash );
+      fclose( fp );
+    } else
+      warning( "Unable to open XCALIB_VIRTUAL_LOG %s", log );
+  }
+
+  for(i = 0; i < v->n; ++i)
+    xcalib_ramp_release( &v->ramps[i] );
+  free( v->writes );
+  free( v->name );
+  free( v );
+}
+
+/*
+ * FUNCTION virtual_open
+ *
+ * parses "virtual:SIZE[,SIZE...][@MICROSECONDS]" with one gamma size
+ * per output, default one output with 256 entries, and the latency of
+ * each reply. Each CRTC starts with the identity.
+ *
+ * returns the virtual display data or NULL on a syntax error
+ */
+static xcalib_virtual_t *
+virtual_open(const char * name)
+{
+  const char * p = name + strlen(VIRTUAL_PREFIX);
+  unsigned int sizes[VIRTUAL_MAX_OUTPUTS];
+  double latency_us = 0.0;
+  xcalib_virtual_t * v;
+  int n = 0, i;
+
+  while(*p && *p != '@')
+  {
+    char * end = NULL;
+    long size = strtol( p, &end, 10 );
+
+    if(end == p || size < 1 || size > 65536 || n == VIRTUAL_MAX_OUTPUTS)
+      return NULL;
+    sizes[n++] = size;
+    p = end;
+    if(*p == ',')
+      ++p;
+  }
+  if(*p == '@')
+  {
+    char * end = NULL;
+
+    latency_us = strtod( p + 1, &end );
+    if(end == p + 1 || *end || latency_us < 0.0)
+      return NULL;
+  }
+  if(!n)
+    sizes[n++] = 256;
+
+  v = (xcalib_virtual_t*) calloc( 1, sizeof(xcalib_virtual_t) );
+  if(!v)
+    return NULL;
+  v->name = strdup( name );
+  v->latency_ms = latency_us / 1000.0;
+  v->start = xcalib_time_ms();
+  v->n = n;
+  for(i = 0; i < n; ++i)
+  {
+    unsigned int k;
+
+    if(!(v->ramps[i] = xcalib_ramp_new( sizes[i] )))
+      break;
+    for(k = 0; k < sizes[i]; ++k)
+      v->ramps[i]->red[k] = v->ramps[i]->green[k] = v->ramps[i]->blue[k] =
+        k * 65535 / sizes[i];
+  }
+  if(!v->name || i < n)
+  {
+    virtual_close( v );
+    return NULL;
+  }
+
+  return v;
+}
+
+static int
+virtual_version(void * data)
+{
+  virtual_request( (xcalib_virtual_t*) data, 1 );
+  return 106;
+}
+
+/*
+ * FUNCTION virtual_get_outputs
+ *
+ * lists all virtual outputs after one simulated round trip
+ *
+ * returns the number of outputs; *outputs is malloc()ed
+ */
+static int
+virtual_get_outputs(void * data, int screen, int xrr_version,
+                    xcalib_output_t ** outputs)
+{
+  xcalib_virtual_t * v = (xcalib_virtual_t*) data;
+  xcalib_output_t * list = (xcalib_output_t*) calloc( v->n, sizeof(xcalib_output_t) );
+  int i;
+
+  (void)screen; (void)xrr_version;
+  virtual_request( v, 1 );
+  *outputs = list;
+  if(!list)
+    return 0;
+  for(i = 0; i < v->n; ++i)
+  {
+    list[i].output = 0x100 + i;
+    list[i].crtc = i + 1;
+    list[i].gamma_size = v->ramps[i]->size;
+    snprintf( list[i].name, sizeof(list[i].name), "VIRTUAL-%d", i );
+  }
+
+  return v->n;
+}
+
+static int
+virtual_ramp_equal(void * data, RRCrtc crtc, const xcalib_ramp_t * ramp)
+{
+  xcalib_virtual_t * v = (xcalib_virtual_t*) data;
+  xcalib_ramp_t * current = virtual_crtc( v, crtc );
+  size_t size = ramp->size * sizeof (u_int16_t);
+
+  virtual_request( v, 1 );
+  return current && current->size == ramp->size &&
+         memcmp( current->red, ramp->red, size ) == 0 &&
+         memcmp( current->green, ramp->green, size ) == 0 &&
+         memcmp( current->blue, ramp->blue, size ) == 0;
+}
+
+static int
+virtual_get(void * data, RRCrtc crtc, xcalib_ramp_t * ramp)
+{
+  xcalib_virtual_t * v = (xcalib_virtual_t*) data;
+  xcalib_ramp_t * current = virtual_crtc( v, crtc );
+  size_t size = ramp->size * sizeof (u_int16_t);
+
+  virtual_request( v, 1 );
+  if(!current || current->size != ramp->size)
+    return -1;
+  memcpy( ramp->red, current->red, size );
+  memcpy( ramp->green, current->green, size );
+  memcpy( ramp->blue, current->blue, size );
+
+  return 0;
+}
+
+/*
+ * FUNCTION virtual_set
+ *
+ * stores the ramp in the virtual CRTC and records the write. As with
+ * XRandR a ramp of the wrong size is refused.
+ *
+ * returns 0 on success, otherwise -1
+ */
+static int
+virtual_set(void * data, RRCrtc crtc, const xcalib_ramp_t * ramp)
+{
+  xcalib_virtual_t * v = (xcalib_virtual_t*) data;
+  xcalib_ramp_t * current = virtual_crtc( v, crtc );
+  size_t size = ramp->size * sizeof (u_int16_t);
+  xcalib_virtual_write_t * w;
+
+  virtual_request( v, 0 );
+  if(!current || current->size != ramp->size)
+    return -1;
+  memcpy( current->red, ramp->red, size );
+  memcpy( current->green, ramp->green, size );
+  memcpy( current->blue, ramp->blue, size );
+
+  if(v->nwrites == v->writes_reserved)
+  {
+    int reserve = v->writes_reserved ? v->writes_reserved * 2 : 64;
+    w = (xcalib_virtual_write_t*) realloc( v->writes, reserve * sizeof(*w) );
+    if(!w)
+      return 0;
+    v->writes = w;
+    v->writes_reserved = reserve;
+  }
+  w = &v->writes[v->nwrites++];
+  w->crtc = crtc;
+  w->size = ramp->size;
+  w->ms = xcalib_time_ms() - v->start;
+  w->hash = hash_fnv1a( 0, ramp->red, size );
+  w->hash = hash_fnv1a( w->hash, ramp->green, size );
+  w->hash = hash_fnv1a( w->hash, ramp->blue, size );
+
+  return 0;
+}
+
+static void
+virtual_sync(void * data)
+{
+  virtual_request( (xcalib_virtual_t*) data, 1 );
+}
+
+static const xcalib_backend_t virtual_backend = {
+  virtual_version, virtual_get_outputs, virtual_ramp_equal, virtual_get,
+  virtual_set, virtual_sync, virtual_close
+};
+
+/*
+ * FUNCTION xcalib_display_new
+ *
+ * wraps the data of a backend into a display for the xcalib_xrr_*
+ * calls; xcalib_display_close() passes data to the close call of the
+ * backend
+ *
+ * returns the display or NULL
+ */
+xcalib_display_t *
+xcalib_display_new(const char * name, const xcalib_backend_t * backend, void * data)
+{
+  xcalib_display_t * display;
+
+  if(!backend)
+    return NULL;
+  display = (xcalib_display_t*) calloc( 1, sizeof(xcalib_display_t) );
+  if(!display)
+    return NULL;
+  display->backend = backend;
+  display->data = data;
+  display->name = strdup( name ? name : "" );
+  if(!display->name)
+  {
+    free( display );
+    return NULL;
+  }
+
+  return display;
+}
+
+/*
+ * FUNCTION xcalib_display_open
+ *
+ * opens a X display or, for names starting with "virtual:", a in
+ * memory display; see virtual_open() for the syntax
+ *
+ * returns the display or NULL
+ */
+xcalib_display_t *
+xcalib_display_open(const char * name)
+{
+  xcalib_display_t * display;
+  Display * dpy;
+
+  if(name && strncmp( name, VIRTUAL_PREFIX, strlen(VIRTUAL_PREFIX) ) == 0)
+  {
+    xcalib_virtual_t * v = virtual_open( name );
+
+    display = v ? xcalib_display_new( name, &virtual_backend, v ) : NULL;
+    if(v && !display)
+      virtual_close( v );
+    return display;
+  }
+
+  dpy = XOpenDisplay( name );
+  count_round_trips(1);
+  if(!dpy)
+    return NULL;
+  display = xcalib_display_new( DisplayString( dpy ), &xrr_backend, dpy );
+  if(!display)
+  {
+    xrr_close( dpy );
+    return NULL;
+  }
+  display->x11 = dpy;
+
+  return display;
+}
+
+/*
+ * FUNCTION xcalib_display_close
+ *
+ * closes a display of xcalib_display_open() or xcalib_display_new().
+ * A virtual display appends its writes to the file named by
+ * XCALIB_VIRTUAL_LOG.
+ */
+void
+xcalib_display_close(xcalib_display_t * display)
+{
+  if(!display)
+    return;
+  if(display->backend->close)
+    display->backend->close( display->data );
+  free( display->name );
+  free( display );
+}
+
+/*
+ * FUNCTION xcalib_display_x11
+ *
+ * returns the X connection of the display or NULL
+ */
+Display *
+xcalib_display_x11(xcalib_display_t * display)
+{
+  return display ? display->x11 : NULL;
+}
+
+/*
+ * FUNCTION xcalib_display_name
+ *
+ * returns the name as given to open or, for X, the one of DisplayString()
+ */
+const char *
+xcalib_display_name(xcalib_display_t * display)
+{
+  return display ? display->name : NULL;
+}
+
+/*
+ * FUNCTION xcalib_display_is_virtual
+ *
+ * returns 1 for a display of xcalib_display_open("virtual:..."), otherwise 0
+ */
+int
+xcalib_display_is_virtual(xcalib_display_t * display)
+{
+  return display && display->backend == &virtual_backend ? 1 : 0;
+}
+
+/*
+ * FUNCTION xcalib_display_requests
+ *
+ * returns the sequence number of the last X request, for displays
+ * without X connection the number of backend calls
+ */
+unsigned long
+xcalib_display_requests(xcalib_display_t * display)
+{
+  if(!display)
+    return 0;
+  /* NextRequest() starts at 1 */
+  return display->x11 ? NextRequest( display->x11 ) - 1 : display->requests;
+}
+
+/*
+ * FUNCTION xcalib_virtual_writes
+ *
+ * returns the number of ramps written to a virtual display; *writes
+ * points to them until the display is closed
+ */
+int
+xcalib_virtual_writes(xcalib_display_t * display, const xcalib_virtual_write_t ** writes)
+{
+  xcalib_virtual_t * v = xcalib_display_is_virtual( display ) ?
+                         (xcalib_virtual_t*) display->data : NULL;
+
+  *writes = v ? v->writes : NULL;
+  return v ? v->nwrites : 0;
+}
+
+/*
+ * FUNCTION xcalib_xrr_version
+ *
+ * returns the XRandR version as major * 100 + minor, 0 without XRandR
+ */
+int
+xcalib_xrr_version(xcalib_display_t * display)
+{
+  ++display->requests;
+  return display->backend->version( display->data );
+}
+
+int
+xcalib_xrr_get_outputs(xcalib_display_t * display, int screen, int xrr_version,
+                       xcalib_output_t ** outputs)
+{
+  ++display->requests;
+  return display->backend->get_outputs( display->data, screen, xrr_version, outputs );
+}
+
+int
+xcalib_xrr_ramp_equal(xcalib_display_t * display, RRCrtc crtc, const xcalib_ramp_t * ramp)
+{
+  ++display->requests;
+  return display->backend->ramp_equal( display->data, crtc, ramp );
+}
+
+int
+xcalib_xrr_get(xcalib_display_t * display, RRCrtc crtc, xcalib_ramp_t * ramp)
+{
+  ++display->requests;
+  return display->backend->get( display->data, crtc, ramp );
+}
+
+int
+xcalib_xrr_set(xcalib_display_t * display, RRCrtc crtc, const xcalib_ramp_t * ramp)
+{
+  ++display->requests;
+  return display->backend->set( display->data, crtc, ramp );
+}
+
+/*
+ * FUNCTION display_sync
+ *
+ * waits until the backend processed all requests
+ */
+static void
+display_sync(xcalib_display_t * display)
+{
+  ++display->requests;
+  display->backend->sync( display->data );
+}
+
+/*
+ * FUNCTION xcalib_xrr_apply
+ *
+ * uploads the ramp to a CRTC, unless the CRTC holds it already
+ *
+ * returns
+ * -1: error
+ * 0: success
+ * 1: unchanged, nothing written
+ */
+int
+xcalib_xrr_apply(xcalib_display_t * display, RRCrtc crtc, const xcalib_ramp_t * ramp)
+{
+  if(xcalib_xrr_ramp_equal( display, crtc, ramp ))
+    return 1;
+
+  return xcalib_xrr_set( display, crtc, ramp );
+}
+
+/*
+ * FUNCTION xcalib_xrr_fade_crtcs
+ *
+ * moves n CRTCs of one display in step from their current ramps to
+ * the ramps to within duration_ms milliseconds at up to fps frames per
+ * second. The frames are paced on absolute deadlines. After each frame
+ * XSync() waits for the server, so a slow driver gets fewer frames
+ * instead of a growing request queue; frames, whose deadline has
+ * passed, are dropped. The last frame is always the target ramp.
+ * CRTCs without a readable start get the target with the last frame.
+ *
+ * returns the number of frames written or -1 on error
+ */
+int
+xcalib_xrr_fade_crtcs(xcalib_display_t * display, int n, const RRCrtc * crtcs,
+                      const xcalib_ramp_t * const * to,
+                      double duration_ms, double fps)
+{
+  xcalib_ramp_t ** from = (xcalib_ramp_t **) calloc( n > 0 ? n : 1, sizeof(xcalib_ramp_t *) );
+  xcalib_ramp_t ** frame = (xcalib_ramp_t **) calloc( n > 0 ? n : 1, sizeof(xcalib_ramp_t *) );
+  double period = 1000.0 / (fps > 0.0 ? fps : 60.0), start, due;
+  long k = 0;
+  int i, readable = 0, frames = 0, error = 0;
+
+  for(i = 0; from && frame && i < n; ++i)
+  {
+    from[i] = xcalib_ramp_new( to[i]->size );
+    frame[i] = xcalib_ramp_new( to[i]->size );
+    if(!from[i] || !frame[i])
+      error = 1;
+    else if(duration_ms > 0.0 && xcalib_xrr_get( display, crtcs[i], from[i] ) == 0)
+      ++readable;
+    else
+      xcalib_ramp_release( &from[i] );
+  }
+  if(!from || !frame)
+    error = 1;
+
+  if(!error && readable)
+  {
+    start = xcalib_time_ms();
+    for(;;)
+    {
+      double now = xcalib_time_ms();
+
+      due = start + ++k * period;
+      if(due < now)
+      {
+        /* behind schedule, drop the missed frames */
+        k = (long)((now - start) / period) + 1;
+        due = start + k * period;
+      }
+      if(due >= start + duration_ms)
+        break;
+
+      for(i = 0; i < n; ++i)
+        if(from[i])
+          xcalib_ramp_mix( from[i], to[i], (due - start) / duration_ms, frame[i] );
+      sleep_until( due );
+      for(i = 0; i < n; ++i)
+        if(from[i] && xcalib_xrr_set( display, crtcs[i], frame[i] ))
+          break;
+      if(i < n)
+        break;
+      display_sync( display );
+      ++frames;
+    }
+  }
+
+  for(i = 0; from && frame && i < n; ++i)
+  {
+    xcalib_ramp_release( &from[i] );
+    xcalib_ramp_release( &frame[i] );
+  }
+  free( from );
+  free( frame );
+  if(error)
+    return -1;
+
+  for(i = 0; i < n; ++i)
+    if(xcalib_xrr_set( display, crtcs[i], to[i] ))
+      error = 1;
+  display_sync( display );
+
+  return error ? -1 : frames + 1;
+}
+
+/*
+ * FUNCTION xcalib_xrr_fade
+ *
+ * fades one CRTC, see xcalib_xrr_fade_crtcs()
+ *
+ * returns the number of frames written or -1 on error
+ */
+int
+xcalib_xrr_fade(xcalib_display_t * display, RRCrtc crtc, const xcalib_ramp_t * to,
+                double duration_ms, double fps)
+{
+  return xcalib_xrr_fade_crtcs( display, 1, &crtc, &to, duration_ms, fps );
+}
+#endif /* _WIN32 */
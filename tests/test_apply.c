@@ -0,0 +1,331 @@
+/*
+ * xcalib - download vcgt gamma tables to your X11 video card
+ *
+ * (c) 2004-2005 Stefan Doehla <stefan AT doehla DOT de>
+ *
+ * This program is GPL-ed postcardware! please see README
+ *
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA.
+ */
+
+/*
+ * test_apply runs one apply per bundled profile on a virtual display
+ * with a 256 and a 1024 entry output: open, XRandR probe, load, upload,
+ * read back and close. It fails, when
+ * - the read back ramp differs from the uploaded one,
+ * - a second upload of the same ramp is not skipped,
+ * - the hashes of the writes differ from the golden file.
+ * The time of each apply is only reported. --update rewrites the
+ * golden file from the current code; test_xrandr checks the same
+ * hashes on a X server. A backend of the test itself checks, that
+ * xcalib_display_new() routes the xcalib_xrr_* calls to it.
+ *
+ * usage: test_apply PROFILE_DIR GOLDEN_FILE [--update]
+ */
+
+/* vim: set ai ts=2 sw=2 expandtab: */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xcalib.h"
+
+static const char * test_profiles[] = {
+  "bluish.icc",
+  "gamma_1_0.icc",
+  "gamma_2_2.icc",
+  "gamma_2_2_bright.icc",
+  "gamma_2_2_lowContrast.icc",
+  "AdobeGammaTest.icm",
+  NULL
+};
+
+#define TEST_DISPLAY "virtual:256,1024"
+
+/*
+ * FUNCTION test_profile
+ *
+ * applies a profile to all outputs of a new virtual display and appends
+ * one "profile crtc size hash" line per write to result
+ *
+ * returns the number of failures
+ */
+static int
+test_profile(const char * dir, const char * profile, char * result, size_t len)
+{
+  xcalib_state_t state = XCALIB_STATE_INIT;
+  xcalib_display_t * display = xcalib_display_open(TEST_DISPLAY);
+  xcalib_output_t * outputs = NULL;
+  const xcalib_virtual_write_t * writes = NULL;
+  char filename[1024];
+  int n, i, nwrites, failed = 0;
+
+  snprintf(filename, sizeof(filename), "%s/%s", dir, profile);
+  if(!display)
+  {
+    fprintf(stderr, "%s: can not open %s\n", profile, TEST_DISPLAY);
+    return 1;
+  }
+
+  n = xcalib_xrr_get_outputs(display, 0, xcalib_xrr_version(display), &outputs);
+  if(n != 2)
+  {
+    fprintf(stderr, "%s: %d outputs instead of 2\n", profile, n);
+    ++failed;
+  }
+  for(i = 0; i < n; ++i)
+  {
+    xcalib_ramp_t * ramp = xcalib_ramp_new(outputs[i].gamma_size),
+                  * back = xcalib_ramp_new(outputs[i].gamma_size);
+    size_t size = outputs[i].gamma_size * sizeof(unsigned short);
+
+    if(!ramp || !back ||
+       xcalib_ramp_load(ramp, filename, NULL, 0, 0, &state) <= 0)
+    {
+      fprintf(stderr, "%s: no ramp for %s\n", profile, outputs[i].name);
+      ++failed;
+    }
+    else if(xcalib_xrr_apply(display, outputs[i].crtc, ramp) != 0)
+    {
+      fprintf(stderr, "%s: upload to %s failed\n", profile, outputs[i].name);
+      ++failed;
+    }
+    else if(xcalib_xrr_get(display, outputs[i].crtc, back) ||
+            memcmp(back->red, ramp->red, size) ||
+            memcmp(back->green, ramp->green, size) ||
+            memcmp(back->blue, ramp->blue, size))
+    {
+      fprintf(stderr, "%s: %s reads back other ramps\n", profile, outputs[i].name);
+      ++failed;
+    }
+    else if(xcalib_xrr_apply(display, outputs[i].crtc, ramp) != 1)
+    {
+      fprintf(stderr, "%s: %s was written again with the same ramps\n", profile, outputs[i].name);
+      ++failed;
+    }
+    xcalib_ramp_release(&ramp);
+    xcalib_ramp_release(&back);
+  }
+
+  nwrites = xcalib_virtual_writes(display, &writes);
+  for(i = 0; i < nwrites; ++i)
+  {
+    size_t used = strlen(result);
+    snprintf(result + used, len - used, "%s %lu %u %016llx\n", profile,
+             (unsigned long)writes[i].crtc, writes[i].size, writes[i].hash);
+  }
+
+  free(outputs);
+  xcalib_display_close(display);
+
+  return failed;
+}
+
+/* a caller backend with one CRTC; counts the writes and the close */
+typedef struct {
+  xcalib_ramp_t * crtc;
+  int sets;
+  int closed;
+} test_backend_t;
+
+static int
+test_backend_version(void * data)
+{
+  (void)data;
+  return 105;
+}
+
+static int
+test_backend_get_outputs(void * data, int screen, int xrr_version,
+                         xcalib_output_t ** outputs)
+{
+  test_backend_t * b = (test_backend_t *) data;
+
+  (void)screen; (void)xrr_version;
+  *outputs = (xcalib_output_t *) calloc(1, sizeof(xcalib_output_t));
+  if(!*outputs)
+    return 0;
+  (*outputs)->crtc = 1;
+  (*outputs)->gamma_size = b->crtc->size;
+  snprintf((*outputs)->name, sizeof((*outputs)->name), "TEST-0");
+  return 1;
+}
+
+static int
+test_backend_get(void * data, RRCrtc crtc, xcalib_ramp_t * ramp)
+{
+  test_backend_t * b = (test_backend_t *) data;
+  size_t size = ramp->size * sizeof(unsigned short);
+
+  if(crtc != 1 || ramp->size != b->crtc->size)
+    return -1;
+  memcpy(ramp->red, b->crtc->red, size);
+  memcpy(ramp->green, b->crtc->green, size);
+  memcpy(ramp->blue, b->crtc->blue, size);
+  return 0;
+}
+
+static int
+test_backend_ramp_equal(void * data, RRCrtc crtc, const xcalib_ramp_t * ramp)
+{
+  test_backend_t * b = (test_backend_t *) data;
+  size_t size = ramp->size * sizeof(unsigned short);
+
+  return crtc == 1 && ramp->size == b->crtc->size &&
+         memcmp(ramp->red, b->crtc->red, size) == 0 &&
+         memcmp(ramp->green, b->crtc->green, size) == 0 &&
+         memcmp(ramp->blue, b->crtc->blue, size) == 0;
+}
+
+static int
+test_backend_set(void * data, RRCrtc crtc, const xcalib_ramp_t * ramp)
+{
+  test_backend_t * b = (test_backend_t *) data;
+  size_t size = ramp->size * sizeof(unsigned short);
+
+  if(crtc != 1 || ramp->size != b->crtc->size)
+    return -1;
+  memcpy(b->crtc->red, ramp->red, size);
+  memcpy(b->crtc->green, ramp->green, size);
+  memcpy(b->crtc->blue, ramp->blue, size);
+  ++b->sets;
+  return 0;
+}
+
+static void
+test_backend_sync(void * data)
+{
+  (void)data;
+}
+
+static void
+test_backend_close(void * data)
+{
+  ((test_backend_t *) data)->closed = 1;
+}
+
+static const xcalib_backend_t test_backend = {
+  test_backend_version, test_backend_get_outputs, test_backend_ramp_equal,
+  test_backend_get, test_backend_set, test_backend_sync, test_backend_close
+};
+
+/*
+ * FUNCTION test_caller_backend
+ *
+ * applies a profile through test_backend
+ *
+ * returns the number of failures
+ */
+static int
+test_caller_backend(const char * dir)
+{
+  xcalib_state_t state = XCALIB_STATE_INIT;
+  test_backend_t b = { NULL, 0, 0 };
+  xcalib_display_t * display;
+  xcalib_output_t * outputs = NULL;
+  xcalib_ramp_t * ramp = xcalib_ramp_new(256);
+  char filename[1024];
+  int failed = 0;
+
+  snprintf(filename, sizeof(filename), "%s/%s", dir, test_profiles[0]);
+  b.crtc = xcalib_ramp_new(256);
+  display = xcalib_display_new("test", &test_backend, &b);
+  if(!display || !ramp || !b.crtc ||
+     xcalib_ramp_load(ramp, filename, NULL, 0, 0, &state) <= 0)
+  {
+    fprintf(stderr, "caller backend: can not set up\n");
+    ++failed;
+  }
+  else if(xcalib_display_x11(display) || xcalib_display_is_virtual(display) ||
+          xcalib_xrr_version(display) != 105 ||
+          xcalib_xrr_get_outputs(display, 0, 105, &outputs) != 1 ||
+          xcalib_xrr_apply(display, outputs[0].crtc, ramp) != 0 ||
+          xcalib_xrr_apply(display, outputs[0].crtc, ramp) != 1 ||
+          xcalib_xrr_fade(display, outputs[0].crtc, ramp, 0.0, 60.0) != 1 ||
+          b.sets != 2 || xcalib_display_requests(display) != 7)
+  {
+    fprintf(stderr, "caller backend: calls not routed to it\n");
+    ++failed;
+  }
+  free(outputs);
+  xcalib_display_close(display);
+  if(display && !b.closed)
+  {
+    fprintf(stderr, "caller backend: not closed\n");
+    ++failed;
+  }
+  xcalib_ramp_release(&ramp);
+  xcalib_ramp_release(&b.crtc);
+
+  return failed;
+}
+
+int
+main(int argc, char ** argv)
+{
+  const char * dir, * golden;
+  int update = 0, failed = 0, i, p;
+  char result[4096] = "", expected[4096] = "";
+  FILE * fp;
+
+  if(argc < 3)
+  {
+    fprintf(stderr, "usage: %s PROFILE_DIR GOLDEN_FILE [--update]\n", argv[0]);
+    return 1;
+  }
+  dir = argv[1];
+  golden = argv[2];
+  for(i = 3; i < argc; ++i)
+    if(strcmp(argv[i], "--update") == 0)
+      update = 1;
+
+  for(p = 0; test_profiles[p]; ++p)
+  {
+    double start = xcalib_time_ms();
+
+    failed += test_profile(dir, test_profiles[p], result, sizeof(result));
+    printf("%-26s %8.3f ms\n", test_profiles[p], xcalib_time_ms() - start);
+  }
+  failed += test_caller_backend(dir);
+
+  if(update)
+  {
+    fp = fopen(golden, "w");
+    if(!fp || fputs(result, fp) < 0)
+      ++failed;
+    if(fp)
+      fclose(fp);
+    return failed ? 1 : 0;
+  }
+
+  fp = fopen(golden, "r");
+  if(!fp)
+  {
+    fprintf(stderr, "can not read %s\n", golden);
+    return 1;
+  }
+  i = fread(expected, 1, sizeof(expected) - 1, fp);
+  expected[i > 0 ? i : 0] = '\0';
+  fclose(fp);
+  if(strcmp(result, expected) != 0)
+  {
+    fprintf(stderr, "writes differ from %s:\n%s", golden, result);
+    ++failed;
+  }
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,257 @@
+/*
+ * xcalib - download vcgt gamma tables to your X11 video card
+ *
+ * (c) 2004-2005 Stefan Doehla <stefan AT doehla DOT de>
+ *
+ * This program is GPL-ed postcardware! please see README
+ *
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA.
+ */
+
+/*
+ * test_threads runs xcalib_ramp_load() from several threads, each with
+ * its own xcalib_state_t, on a shared cache directory. The threads come
+ * in groups with the same correction and ramp size, which start each
+ * round together in a new subdirectory; so the threads of a group
+ * write and read the same cache files at once. Every result must equal
+ * the ramps computed beforehand in one thread without cache, and each
+ * round must leave exactly one file per cache entry behind.
+ *
+ * usage: test_threads PROFILE_DIR CACHE_DIR
+ */
+
+/* vim: set ai ts=2 sw=2 expandtab: */
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xcalib.h"
+
+#define TEST_VARIANTS 4
+#define TEST_THREADS (4 * TEST_VARIANTS)  /* four threads share each cache entry */
+#define TEST_ROUNDS 100
+
+static const char * test_profiles[] = {
+  "bluish.icc",
+  "gamma_1_0.icc",
+  "gamma_2_2.icc",
+  "gamma_2_2_bright.icc",
+  "gamma_2_2_lowContrast.icc",
+  "AdobeGammaTest.icm",
+  NULL
+};
+#define TEST_PROFILES 6
+
+/* the calibration of one thread */
+typedef struct {
+  xcalib_state_t state;
+  int correction;
+  int invert;
+  unsigned int size;
+  char filenames[TEST_PROFILES][1024];
+  xcalib_ramp_t * expected[TEST_PROFILES];
+  const char * cache_dir;
+  int failed;
+} test_job_t;
+
+/* lets all threads start a round together */
+static struct {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int waiting;
+  int round;
+} test_barrier = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0 };
+
+static void
+test_barrier_wait(void)
+{
+  int round;
+
+  pthread_mutex_lock(&test_barrier.lock);
+  round = test_barrier.round;
+  if(++test_barrier.waiting == TEST_THREADS)
+  {
+    test_barrier.waiting = 0;
+    ++test_barrier.round;
+    pthread_cond_broadcast(&test_barrier.cond);
+  }
+  else
+    while(round == test_barrier.round)
+      pthread_cond_wait(&test_barrier.cond, &test_barrier.lock);
+  pthread_mutex_unlock(&test_barrier.lock);
+}
+
+/* the message hook is shared by all threads */
+static int
+test_message(int code, const void * context, const char * format, ...)
+{
+  (void)context; (void)format;
+  if(code == XCALIB_MSG_WARNING || code == XCALIB_MSG_ERROR)
+  {
+    static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    va_list list;
+
+    pthread_mutex_lock(&lock);
+    va_start(list, format);
+    vfprintf(stderr, format, list);
+    va_end(list);
+    fputc('\n', stderr);
+    pthread_mutex_unlock(&lock);
+  }
+  return 0;
+}
+
+static int
+test_ramp_equal(const xcalib_ramp_t * a, const xcalib_ramp_t * b)
+{
+  size_t size = a->size * sizeof(unsigned short);
+
+  return a->size == b->size &&
+         memcmp(a->red, b->red, size) == 0 &&
+         memcmp(a->green, b->green, size) == 0 &&
+         memcmp(a->blue, b->blue, size) == 0;
+}
+
+static void *
+test_worker(void * arg)
+{
+  test_job_t * job = (test_job_t *) arg;
+  xcalib_ramp_t * ramp = xcalib_ramp_new(job->size);
+  char dir[1024];
+  int r, p;
+
+  for(r = 0; r < TEST_ROUNDS; ++r)
+  {
+    snprintf(dir, sizeof(dir), "%s/%d", job->cache_dir, r);
+    test_barrier_wait();
+    for(p = 0; ramp && p < TEST_PROFILES; ++p)
+    {
+      memset(ramp->red, 0, 3 * job->size * sizeof(unsigned short));
+      if(xcalib_ramp_load(ramp, job->filenames[p], dir,
+                          job->correction, job->invert, &job->state) <= 0 ||
+         !test_ramp_equal(ramp, job->expected[p]))
+        ++job->failed;
+    }
+  }
+  if(!ramp)
+    job->failed = 1;
+  xcalib_ramp_release(&ramp);
+
+  return NULL;
+}
+
+/*
+ * FUNCTION test_count_files
+ *
+ * returns the number of files in dir, -1 if it can not be read
+ */
+static int
+test_count_files(const char * dir)
+{
+  DIR * d = opendir(dir);
+  struct dirent * e;
+  int n = 0;
+
+  if(!d)
+    return -1;
+  while((e = readdir(d)) != NULL)
+    if(e->d_name[0] != '.')
+      ++n;
+  closedir(d);
+
+  return n;
+}
+
+int
+main(int argc, char ** argv)
+{
+  test_job_t jobs[TEST_THREADS];
+  pthread_t threads[TEST_THREADS];
+  int i, p, r, failed = 0;
+
+  if(argc < 3)
+  {
+    fprintf(stderr, "usage: %s PROFILE_DIR CACHE_DIR\n", argv[0]);
+    return 1;
+  }
+  xcalib_set_message_func(test_message);
+
+  /* references in this thread without cache */
+  for(i = 0; i < TEST_THREADS; ++i)
+  {
+    test_job_t * job = &jobs[i];
+    xcalib_state_t init = XCALIB_STATE_INIT;
+    int v = i % TEST_VARIANTS;
+
+    memset(job, 0, sizeof(*job));
+    job->state = init;
+    job->correction = xcalib_set_correction(&job->state, 1.0 + 0.2 * v,
+                                            5.0 * (v % 3), 100.0 - 10.0 * (v % 2));
+    job->invert = v % 2;
+    job->size = 256u << (v % 3);
+    job->cache_dir = argv[2];
+    for(p = 0; p < TEST_PROFILES; ++p)
+    {
+      snprintf(job->filenames[p], sizeof(job->filenames[p]), "%s/%s", argv[1], test_profiles[p]);
+      job->expected[p] = xcalib_ramp_new(job->size);
+      if(!job->expected[p] ||
+         xcalib_ramp_load(job->expected[p], job->filenames[p], NULL,
+                          job->correction, job->invert, &job->state) <= 0)
+      {
+        fprintf(stderr, "no reference for %s\n", job->filenames[p]);
+        return 1;
+      }
+    }
+  }
+
+  for(i = 0; i < TEST_THREADS; ++i)
+    if(pthread_create(&threads[i], NULL, test_worker, &jobs[i]))
+    {
+      fprintf(stderr, "can not start thread %d\n", i);
+      return 1;
+    }
+  for(i = 0; i < TEST_THREADS; ++i)
+  {
+    pthread_join(threads[i], NULL);
+    if(jobs[i].failed)
+      fprintf(stderr, "thread %d: %d of %d loads differ\n", i, jobs[i].failed,
+              TEST_ROUNDS * TEST_PROFILES);
+    failed += jobs[i].failed;
+    for(p = 0; p < TEST_PROFILES; ++p)
+      xcalib_ramp_release(&jobs[i].expected[p]);
+  }
+
+  /* one entry per variant and profile, no temporary files left */
+  for(r = 0; r < TEST_ROUNDS; ++r)
+  {
+    char dir[1024];
+    int n;
+
+    snprintf(dir, sizeof(dir), "%s/%d", argv[2], r);
+    n = test_count_files(dir);
+    if(n != TEST_VARIANTS * TEST_PROFILES)
+    {
+      fprintf(stderr, "%s: %d files instead of %d\n", dir, n, TEST_VARIANTS * TEST_PROFILES);
+      ++failed;
+    }
+  }
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * xcalib - download vcgt gamma tables to your X11 video card
+ *
+ * (c) 2004-2005 Stefan Doehla <stefan AT doehla DOT de>
+ *
+ * This program is GPL-ed postcardware! please see README
+ *
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA.
+ */
+
+/*
+ * test_xrandr reads the gamma ramps of all active CRTCs of a X server
+ * back with plain XRRGetCrtcGamma(), after xcalib uploaded a profile
+ * there. Each ramp must equal the one xcalib_ramp_load() computes for
+ * the CRTC size and, for sizes in the golden file of test_apply, hash
+ * to the value the virtual display recorded for that profile.
+ *
+ * usage: test_xrandr DISPLAY PROFILE GOLDEN_FILE
+ *
+ * returns 0 on success, 77 when the server has no XRandR 1.2 gamma
+ * and 1 on a mismatch
+ */
+
+/* vim: set ai ts=2 sw=2 expandtab: */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xcalib.h"
+
+#define TEST_SKIP 77
+
+/* 64-bit FNV-1a as for xcalib_virtual_write_t */
+static unsigned long long
+test_fnv1a(unsigned long long h, const unsigned short * data, int n)
+{
+  const unsigned char * p = (const unsigned char *) data;
+  size_t i;
+
+  for(i = 0; i < n * sizeof(unsigned short); ++i)
+  {
+    h ^= p[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+/*
+ * FUNCTION test_golden_hash
+ *
+ * looks up the "profile crtc size hash" line of test_apply
+ *
+ * returns 1 and sets hash, if the golden file has the size
+ */
+static int
+test_golden_hash(const char * golden, const char * profile, int size,
+                 unsigned long long * hash)
+{
+  FILE * fp = fopen(golden, "r");
+  const char * base = strrchr(profile, '/') ? strrchr(profile, '/') + 1 : profile;
+  char name[256];
+  unsigned long crtc;
+  unsigned int s;
+  int found = 0;
+
+  if(!fp)
+    return 0;
+  while(!found && fscanf(fp, "%255s %lu %u %llx", name, &crtc, &s, hash) == 4)
+    found = strcmp(name, base) == 0 && (int)s == size;
+  fclose(fp);
+
+  return found;
+}
+
+int
+main(int argc, char ** argv)
+{
+  Display * dpy;
+  XRRScreenResources * res;
+  int major = 0, minor = 0, i, checked = 0, failed = 0;
+
+  if(argc < 4)
+  {
+    fprintf(stderr, "usage: %s DISPLAY PROFILE GOLDEN_FILE\n", argv[0]);
+    return 1;
+  }
+
+  dpy = XOpenDisplay(argv[1]);
+  if(!dpy)
+  {
+    fprintf(stderr, "can not open display %s\n", argv[1]);
+    return 1;
+  }
+  if(!XRRQueryVersion(dpy, &major, &minor) || major * 100 + minor < 102)
+  {
+    fprintf(stderr, "%s: no XRandR 1.2\n", argv[1]);
+    XCloseDisplay(dpy);
+    return TEST_SKIP;
+  }
+
+  res = XRRGetScreenResourcesCurrent(dpy, DefaultRootWindow(dpy));
+  for(i = 0; res && i < res->ncrtc; ++i)
+  {
+    XRRCrtcInfo * info = XRRGetCrtcInfo(dpy, res, res->crtcs[i]);
+    int size = XRRGetCrtcGammaSize(dpy, res->crtcs[i]);
+    int active = info && info->mode != None;
+    xcalib_state_t state = XCALIB_STATE_INIT;
+    xcalib_ramp_t * ramp;
+    XRRCrtcGamma * gamma;
+    unsigned long long hash, expected;
+
+    if(info)
+      XRRFreeCrtcInfo(info);
+    if(!active || size <= 0)
+      continue;
+
+    ramp = xcalib_ramp_new(size);
+    gamma = XRRGetCrtcGamma(dpy, res->crtcs[i]);
+    ++checked;
+    if(!ramp || !gamma ||
+       xcalib_ramp_load(ramp, argv[2], NULL, 0, 0, &state) <= 0)
+    {
+      fprintf(stderr, "%s: can not compare CRTC %lu\n", argv[2], (unsigned long)res->crtcs[i]);
+      ++failed;
+    }
+    else if(memcmp(gamma->red, ramp->red, size * sizeof(unsigned short)) ||
+            memcmp(gamma->green, ramp->green, size * sizeof(unsigned short)) ||
+            memcmp(gamma->blue, ramp->blue, size * sizeof(unsigned short)))
+    {
+      fprintf(stderr, "%s: CRTC %lu reads back other ramps\n", argv[2], (unsigned long)res->crtcs[i]);
+      ++failed;
+    }
+    else
+    {
+      hash = test_fnv1a(0xcbf29ce484222325ULL, gamma->red, size);
+      hash = test_fnv1a(hash, gamma->green, size);
+      hash = test_fnv1a(hash, gamma->blue, size);
+      if(test_golden_hash(argv[3], argv[2], size, &expected) && hash != expected)
+      {
+        fprintf(stderr, "%s: CRTC %lu hash %016llx, golden %016llx\n", argv[2],
+                (unsigned long)res->crtcs[i], hash, expected);
+        ++failed;
+      }
+    }
+    if(gamma)
+      XRRFreeGamma(gamma);
+    xcalib_ramp_release(&ramp);
+  }
+  if(res)
+    XRRFreeScreenResources(res);
+  XCloseDisplay(dpy);
+
+  if(!checked)
+  {
+    fprintf(stderr, "%s: no active CRTC with gamma\n", argv[1]);
+    return TEST_SKIP;
+  }
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,40 @@
+#!/bin/sh
+# applies each bundled profile with xcalib to a new Xvfb server and
+# checks the ramps read back from it with test_xrandr
+#
+# usage: xvfb_apply.sh XVFB XCALIB TEST_XRANDR PROFILE_DIR GOLDEN_FILE
+# exits 77, when the server has no XRandR 1.2 gamma
+
+XVFB=$1
+XCALIB=$2
+TEST_XRANDR=$3
+PROFILE_DIR=$4
+GOLDEN=$5
+
+DISPLAY_FILE=`mktemp` || exit 1
+"$XVFB" -displayfd 3 -screen 0 640x480x24 -nolisten tcp 3>"$DISPLAY_FILE" >/dev/null 2>&1 &
+XVFB_PID=$!
+trap 'kill $XVFB_PID 2>/dev/null; rm -f "$DISPLAY_FILE"' EXIT
+
+# Xvfb writes its display number, once it accepts connections
+i=0
+while [ ! -s "$DISPLAY_FILE" ]; do
+  i=`expr $i + 1`
+  if [ $i -gt 100 ] || ! kill -0 $XVFB_PID 2>/dev/null; then
+    echo "Xvfb did not start"
+    exit 1
+  fi
+  sleep 0.1
+done
+DPY=:`head -n 1 "$DISPLAY_FILE"`
+
+for PROFILE in bluish.icc gamma_1_0.icc gamma_2_2.icc gamma_2_2_bright.icc \
+               gamma_2_2_lowContrast.icc AdobeGammaTest.icm; do
+  "$XCALIB" -d "$DPY" --all-outputs "$PROFILE_DIR/$PROFILE" || exit 1
+  "$TEST_XRANDR" "$DPY" "$PROFILE_DIR/$PROFILE" "$GOLDEN"
+  RET=$?
+  [ $RET -ne 0 ] && exit $RET
+  echo "$PROFILE: ok"
+done
+
+exit 0
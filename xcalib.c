@@ -46,6 +46,12 @@
 #include <fcntl.h>
 #include <string.h>
 #include <sys/types.h>
+#ifndef _WIN32
+# include <pthread.h>
+# include <signal.h>
+# include <sys/select.h>
+# include <unistd.h>
+#endif
 
 #ifdef INCLUDE_OYJL_C
 # include "extras/oyjl_args.c"
@@ -58,8 +64,46 @@ extern char **environ;
 #ifdef OYJL_HAVE_LOCALE_H
 # include <locale.h>
 #endif
+/* for X11 VidMode stuff */
+#ifndef _WIN32
+# include <X11/Xos.h>
+# include <X11/Xlib.h>
+# include <X11/Xutil.h>
+# include <X11/extensions/xf86vmode.h>
+# include <X11/extensions/Xrandr.h>
+# ifdef FGLRX
+#  include <fglrx_gamma.h>
+# endif
+#else
+# include <windows.h>
+# include <wingdi.h>
+#endif
+
+#include <math.h>
+
+#include "xcalib.h"
+
 #define MY_DOMAIN "xcalib"
 oyjlTranslation_s * trc = NULL;
+/* locale of the translations, set in main() */
+static const char * xcalib_loc = NULL;
+static int xcalib_use_gettext = 0;
+/* duration of the translation setup for --timings; it runs inside
+ * the stage, which calls _() first */
+static double xcalib_translation_ms = 0.0;
+
+/*
+ * FUNCTION locale_is_c
+ *
+ * returns 1 for a missing, C or POSIX locale, which need no translation
+ */
+static int
+locale_is_c(const char * loc)
+{
+  return !loc || !loc[0] || strcmp(loc, "C") == 0 || strncmp(loc, "C.", 2) == 0 ||
+         strcmp(loc, "POSIX") == 0;
+}
+
 #ifdef INCLUDE_OYJL_C
 # ifdef _
 #  undef _
@@ -71,37 +115,115 @@ oyjlTranslation_s * trc = NULL;
 # ifdef _
 #  undef _
 # endif
-# define _(text) oyjlTranslate( trc, text )
-#endif
+# define _(text) xcalib_translate( text )
+# include "xcalib.i18n.h"
+# include "xcalib.i18n.tab.h"
+/* sorted msgid, msgstr pairs of the locale language or NULL */
+static const char * const (*xcalib_i18n_table)[2] = NULL;
+static int xcalib_i18n_size = 0;
 
-/* for X11 VidMode stuff */
+/*
+ * FUNCTION translation_init
+ *
+ * sets up the translation context. A C or POSIX locale skips the
+ * catalog and the Oyjl language setup completely. Oyjl takes ownership
+ * of the catalog and of the context and frees both in oyjlLibRelease(),
+ * so the embedded catalog is copied once here and trc stays valid.
+ */
+static void
+translation_init(void)
+{
+  oyjl_val catalog;
+  oyjlTranslation_s * trc_;
+  double start = xcalib_time_ms();
+  size_t len;
+  int i;
+
+  if(locale_is_c(xcalib_loc))
+    return;
+
+  catalog = (oyjl_val) oyjlStringAppendN( NULL, (const char*) xcalib_i18n_oiJS, sizeof(xcalib_i18n_oiJS), malloc );
+  trc = trc_ = oyjlTranslation_New( xcalib_loc, MY_DOMAIN, &catalog, 0,0,0,0 );
+  oyjlInitLanguageDebug( "xcalib", NULL, NULL, xcalib_use_gettext, NULL, NULL, &trc_, NULL );
+
+  /* "de_DE.UTF-8" -> "de" */
+  len = strcspn( xcalib_loc, "_.@" );
+  for(i = 0; xcalib_i18n_tables[i].lang; ++i)
+    if(strlen( xcalib_i18n_tables[i].lang ) == len &&
+       strncmp( xcalib_i18n_tables[i].lang, xcalib_loc, len ) == 0)
+    {
+      xcalib_i18n_table = xcalib_i18n_tables[i].table;
+      xcalib_i18n_size = xcalib_i18n_tables[i].size;
+    }
+  xcalib_translation_ms = xcalib_time_ms() - start;
+}
+
+/*
+ * FUNCTION xcalib_translation
+ *
+ * runs translation_init() on the first lookup. The --fleet workers
+ * reach _() through myMessage(), so the setup runs exactly once, also
+ * when threads race for it.
+ *
+ * returns the context or NULL
+ */
+static oyjlTranslation_s *
+xcalib_translation(void)
+{
 #ifndef _WIN32
-# include <X11/Xos.h>
-# include <X11/Xlib.h>
-# include <X11/Xutil.h>
-# include <X11/extensions/xf86vmode.h>
-# include <X11/extensions/Xrandr.h>
-# ifdef FGLRX
-#  include <fglrx_gamma.h>
-# endif
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+  pthread_once( &once, translation_init );
 #else
-# include <windows.h>
-# include <wingdi.h>
+  static int done = 0;
+
+  if(!done)
+  {
+    done = 1;
+    translation_init();
+  }
 #endif
 
-#include <math.h>
+  return trc;
+}
 
-/* the 4-byte marker for the vcgt-Tag */
-#define VCGT_TAG     0x76636774L
-#define MLUT_TAG     0x6d4c5554L
+/*
+ * FUNCTION xcalib_translate
+ *
+ * looks text up by binary search in the table of the locale language,
+ * which cmake/xcalibI18nTable.cmake generates from xcalib.i18n.json.
+ * Languages without a table go through oyjlTranslate().
+ *
+ * returns the translation or text
+ */
+static char *
+xcalib_translate(const char * text)
+{
+  oyjlTranslation_s * tr = xcalib_translation();
+  int low = 0, high = xcalib_i18n_size - 1;
 
-#ifndef XCALIB_VERSION
-# define XCALIB_VERSION "version unknown (>0.5)"
+  if(!xcalib_i18n_table)
+    return tr ? oyjlTranslate( tr, text ) : (char*) text;
+
+  while(low <= high)
+  {
+    int mid = (low + high) / 2,
+        cmp = strcmp( text, xcalib_i18n_table[mid][0] );
+
+    if(cmp == 0)
+      return (char*) xcalib_i18n_table[mid][1];
+    if(cmp < 0)
+      high = mid - 1;
+    else
+      low = mid + 1;
+  }
+
+  return (char*) text;
+}
 #endif
 
-/* a limit to check the table sizes (of corrupted profiles) */
-#ifndef MAX_TABLE_SIZE
-# define MAX_TABLE_SIZE   2e10
+#ifndef XCALIB_VERSION
+# define XCALIB_VERSION "version unknown (>0.5)"
 #endif
 
 #ifdef _WIN32
@@ -120,438 +242,1243 @@ int myMessage                        ( int/*oyjlMSG_e*/    error_code,
 //#define message(...) myMessage( oyjlMSG_INFO, 0, __VA_ARGS__ )
 #define usage() { fprintf( stderr, OYJL_DBG_FORMAT , OYJL_DBG_ARGS ); myUsage( ui ); } 
 
-#if 1
-# define BE_INT(a)    ((a)[3]+((a)[2]<<8)+((a)[1]<<16) +((a)[0]<<24))
-# define BE_SHORT(a)  ((a)[1]+((a)[0]<<8))
-# define ROUND(a)     ((a)+0.5)
+/* -v of the command line tool; the calibrations carry their own */
+static unsigned int xcalib_verbose = 0;
+
+/* one stage of main() and myMain() for --timings */
+typedef struct {
+  const char * name;
+  double ms;
+  unsigned long requests;              /* X requests sent */
+  unsigned long round_trips;           /* replies waited for */
+} xcalib_stage_t;
+
+/* the stages are always recorded, it costs a clock read each;
+ * --timings or XCALIB_TIMINGS print them */
+static struct {
+  int enabled;
+  char display[256];
+  int xrr_version;
+  int outputs;
+  double start;                        /* entry of main() */
+  double last;                         /* end of the previous stage */
+  unsigned long seq;                   /* X sequence number at last */
+  unsigned long round_trips;           /* round trips at last */
+  int n;
+  xcalib_stage_t stage[16];
+} xcalib_timings;
+
+#ifndef _WIN32
+/* requests sent on a display */
+# define TIMING_SEQ(display) ((display) ? xcalib_display_requests(display) : 0)
 #else
-# warning "big endian is NOT TESTED"
-# define BE_INT(a)    (a)
-# define BE_SHORT(a)  (a)
+# define TIMING_SEQ(display) 0
 #endif
 
-/* internal state struct */
-struct xcalib_state_t {
-  unsigned int verbose;
-  float redGamma;
-  float redMin;
-  float redMax;
-  float greenGamma;
-  float greenMin;
-  float greenMax;
-  float blueGamma;
-  float blueMin;
-  float blueMax;
-  float gamma_cor;
-} xcalib_state = {0, 1.0, 0.0, 1.0, 1.0, 0.0, 1.0, 1.0, 0.0, 1.0, 1.0};
+/*
+ * FUNCTION timing_round_trips
+ *
+ * returns the round trips of the tool and the library so far
+ */
+static unsigned long
+timing_round_trips(void)
+{
+#ifndef _WIN32
+  return xcalib_xrr_round_trips();
+#else
+  return 0;
+#endif
+}
+
+/*
+ * FUNCTION timing_stage
+ *
+ * closes the running stage under name. seq is the sequence number
+ * from TIMING_SEQ(); a new connection starts again from zero.
+ */
+static void
+timing_stage(const char * name, unsigned long seq)
+{
+  double now = xcalib_time_ms();
+  unsigned long round_trips = timing_round_trips();
+  xcalib_stage_t * stage;
+
+  if(xcalib_timings.n >= (int)(sizeof(xcalib_timings.stage) / sizeof(xcalib_timings.stage[0])))
+    return;
+  stage = &xcalib_timings.stage[xcalib_timings.n++];
+  stage->name = name;
+  stage->ms = now - xcalib_timings.last;
+  stage->requests = seq >= xcalib_timings.seq ? seq - xcalib_timings.seq : seq;
+  stage->round_trips = round_trips - xcalib_timings.round_trips;
+  xcalib_timings.last = now;
+  xcalib_timings.seq = seq;
+  xcalib_timings.round_trips = round_trips;
+}
+
+/*
+ * FUNCTION json_put_string
+ *
+ * writes text as JSON string with quotes, backslashes and control
+ * characters escaped
+ */
+static void
+json_put_string(FILE * fp, const char * text)
+{
+  const unsigned char * c;
+
+  fputc('"', fp);
+  for(c = (const unsigned char *) text; *c; ++c)
+  {
+    if(*c == '"' || *c == '\\')
+      fprintf(fp, "\\%c", *c);
+    else if(*c < 0x20)
+      fprintf(fp, "\\u%04x", *c);
+    else
+      fputc(*c, fp);
+  }
+  fputc('"', fp);
+}
+
+/*
+ * FUNCTION timing_report
+ *
+ * writes the stages as JSON to XCALIB_TIMINGS, when it names a file,
+ * or to stderr. translations_ms is part of the stage, which first
+ * translated a text.
+ */
+static void
+timing_report(void)
+{
+  const char * path = getenv("XCALIB_TIMINGS");
+  unsigned long requests = 0, round_trips = 0;
+  FILE * fp = stderr;
+  int i;
+#ifdef OYJL_HAVE_LOCALE_H
+  char * save_locale = oyjlStringCopy( setlocale(LC_NUMERIC, 0 ), malloc );
+  setlocale(LC_NUMERIC, "C");
+#endif
+
+  if(path && path[0] && strcmp(path, "1") && strcmp(path, "-"))
+    fp = fopen(path, "w");
+  if(fp)
+  {
+    for(i = 0; i < xcalib_timings.n; ++i)
+    {
+      requests += xcalib_timings.stage[i].requests;
+      round_trips += xcalib_timings.stage[i].round_trips;
+    }
+    fprintf(fp, "{\n  \"version\": \"%s\",\n  \"display\": ", XCALIB_VERSION);
+    json_put_string(fp, xcalib_timings.display);
+    fprintf(fp, ",\n  \"xrandr\": %d,\n  \"outputs\": %d,\n"
+                "  \"total_ms\": %.3f,\n  \"translations_ms\": %.3f,\n"
+                "  \"requests\": %lu,\n  \"round_trips\": %lu,\n"
+                "  \"stages\": [",
+            xcalib_timings.xrr_version, xcalib_timings.outputs,
+            xcalib_timings.last - xcalib_timings.start, xcalib_translation_ms,
+            requests, round_trips);
+    for(i = 0; i < xcalib_timings.n; ++i)
+      fprintf(fp, "%s\n    {\"name\": \"%s\", \"ms\": %.3f, \"requests\": %lu, \"round_trips\": %lu}",
+              i ? "," : "", xcalib_timings.stage[i].name, xcalib_timings.stage[i].ms,
+              xcalib_timings.stage[i].requests, xcalib_timings.stage[i].round_trips);
+    fprintf(fp, "\n  ]\n}\n");
+    if(fp != stderr)
+      fclose(fp);
+  }
+  else
+    fprintf(stderr, "Can not write timings to %s\n", path);
+
+#ifdef OYJL_HAVE_LOCALE_H
+  setlocale(LC_NUMERIC, save_locale);
+  if(save_locale) free( save_locale );
+#endif
+}
+
+#ifdef _WIN32
+/* Win32 monitor enumeration - code by gl.tter ( http://gl.tter.org ) */
+static unsigned int monitorSearchIndex = 0;
+static HDC monitorDC = 0;
+
+/*
+ * FUNCTION MonitorEnumProc
+ *
+ * this is a Win32 callback function which is given as an argument
+ * to EnumDisplayMonitors.
+ *
+ * returns
+ * TRUE: if the current enumerated display is the wrong one
+ * FALSE: if the right monitor was found and the DC was associated
+ */
+BOOL CALLBACK MonitorEnumProc (HMONITOR monitor, HDC hdc, LPRECT rect, LPARAM data)
+{
+  MONITORINFOEX monitorInfo;
+  
+  if(monitorSearchIndex++ != (unsigned int)data)
+    return TRUE; /* continue enumeration */
+  
+  monitorInfo.cbSize = sizeof(monitorInfo);
+  if(GetMonitorInfo(monitor, (LPMONITORINFO)&monitorInfo) )
+    monitorDC = CreateDC(NULL, monitorInfo.szDevice, NULL, NULL);
+  
+  return FALSE;  /* stop enumeration */
+}
+
+/*
+ * FUNCTION FindMonitor
+ *
+ * find a specific monitor given by index. Index -1 is the
+ * primary display.
+ *
+ * returns the DC of the selected monitor
+ */
+HDC FindMonitor(int index)
+{
+  if(index == -1)
+    return GetDC(NULL); /* return primary display context */
+
+  monitorSearchIndex = 0;
+  monitorDC = 0;
+  EnumDisplayMonitors(NULL, NULL, MonitorEnumProc, index);
+  return monitorDC;
+}
+
+#endif
+
+#ifndef _WIN32
+/* one line of a batch list */
+typedef struct {
+  char display[256];
+  char output[64];
+  char profile[4096];
+  double gamma_;
+  double brightness;
+  double contrast;
+  int done;
+} xcalib_batch_t;
+
+/* one output kept calibrated in daemon mode */
+typedef struct {
+  xcalib_display_t * display;
+  xcalib_batch_t * line;
+  RROutput output;             /* 0 until a output of that name appears */
+  RRCrtc crtc;                 /* 0 while the output is off */
+  int gamma_size;              /* of crtc; 0 until queried */
+  xcalib_ramp_t * ramp;        /* NULL until computed */
+  int pending;
+} xcalib_resident_t;
+
+/*
+ * FUNCTION linear_ramp
+ *
+ * fills ramp with the identity as used to reset a output
+ */
+void
+linear_ramp(xcalib_ramp_t * ramp)
+{
+  unsigned int k;
+
+  for(k = 0; k < ramp->size; ++k)
+    ramp->red[k] = ramp->green[k] = ramp->blue[k] = k * 65535 / ramp->size;
+}
+
+/*
+ * FUNCTION default_screen
+ *
+ * returns the default screen of a X connection, 0 for the one screen
+ * of a virtual display
+ */
+int
+default_screen(xcalib_display_t * display)
+{
+  Display * dpy = xcalib_display_x11( display );
+
+  return dpy ? DefaultScreen( dpy ) : 0;
+}
+
+/*
+ * FUNCTION batch_line_ramps
+ *
+ * computes the ramps of one batch line with the batch wide defaults
+ *
+ * returns
+ * -1: error
+ * 0: no profile
+ * 1: success
+ */
+int
+batch_line_ramps(xcalib_batch_t * b, const xcalib_state_t * defaults,
+                 const char * cache_dir, int invert, xcalib_ramp_t * ramp)
+{
+  xcalib_state_t state = *defaults;
+  int correction;
+
+  if(strcmp(b->profile, "-") == 0)
+  {
+    linear_ramp(ramp);
+    return 1;
+  }
+
+  correction = xcalib_set_correction(&state, b->gamma_, b->brightness, b->contrast);
+  return xcalib_ramp_load(ramp, b->profile, cache_dir, correction, invert, &state);
+}
+
+static volatile sig_atomic_t daemon_stop = 0;
+static void daemon_signal(int sig) { (void)sig; daemon_stop = 1; }
+
+/*
+ * FUNCTION daemon_bind_output
+ *
+ * looks up the name of a newly enabled output and attaches it to
+ * the resident entries waiting for that name. The screen resources
+ * are kept in *res until the next RRScreenChangeNotify.
+ */
+void
+daemon_bind_output(xcalib_display_t * display, XRRScreenResources ** res,
+                   RROutput output, RRCrtc crtc,
+                   xcalib_resident_t * resident, int nresident)
+{
+  Display * dpy = xcalib_display_x11( display );
+  XRROutputInfo * output_info;
+  int i;
+
+  if(!*res)
+    *res = XRRGetScreenResourcesCurrent( dpy, DefaultRootWindow( dpy ) );
+  output_info = *res ? XRRGetOutputInfo( dpy, *res, output ) : NULL;
+
+  for(i = 0; output_info && i < nresident; ++i)
+  {
+    xcalib_resident_t * r = &resident[i];
+    if(r->display == display && !r->output && strcmp(r->line->output, output_info->name) == 0)
+    {
+      r->output = output;
+      r->crtc = crtc;
+      r->gamma_size = 0;
+      r->pending = 1;
+    }
+  }
+
+  if(output_info)
+    XRRFreeOutputInfo( output_info );
+}
+
+/*
+ * FUNCTION daemon_event
+ *
+ * marks the resident entries touched by a RandR event for reapplying.
+ * Only a RRScreenChangeNotify drops the cached screen resources and
+ * gamma sizes of the display.
+ */
+void
+daemon_event(xcalib_display_t * display, int event_base, XEvent * ev,
+             XRRScreenResources ** res,
+             xcalib_resident_t * resident, int nresident)
+{
+  int i, found = 0;
+
+  if(ev->type == event_base + RRScreenChangeNotify)
+  {
+    XRRUpdateConfiguration( ev );
+    if(*res)
+      XRRFreeScreenResources( *res );
+    *res = NULL;
+    for(i = 0; i < nresident; ++i)
+      if(resident[i].display == display)
+        resident[i].gamma_size = 0;
+  }
+  else if(ev->type == event_base + RRNotify)
+  {
+    XRRNotifyEvent * ne = (XRRNotifyEvent *) ev;
+
+    if(ne->subtype == RRNotify_OutputChange)
+    {
+      XRROutputChangeNotifyEvent * oe = (XRROutputChangeNotifyEvent *) ev;
+      RRCrtc crtc = oe->mode != None ? oe->crtc : 0;
+      for(i = 0; i < nresident; ++i)
+        if(resident[i].display == display && resident[i].output == oe->output)
+        {
+          if(resident[i].crtc != crtc)
+            resident[i].gamma_size = 0;
+          resident[i].crtc = crtc;
+          resident[i].pending = crtc != 0;
+          found = 1;
+        }
+      if(!found && crtc)
+        daemon_bind_output( display, res, oe->output, crtc, resident, nresident );
+    }
+    else if(ne->subtype == RRNotify_CrtcChange)
+    {
+      XRRCrtcChangeNotifyEvent * ce = (XRRCrtcChangeNotifyEvent *) ev;
+      if(ce->mode != None)
+        for(i = 0; i < nresident; ++i)
+          if(resident[i].display == display && resident[i].crtc == ce->crtc)
+            resident[i].pending = 1;
+    }
+  }
+}
+
+/*
+ * FUNCTION daemon_apply
+ *
+ * uploads the resident ramps of all pending entries of a display.
+ * The ramps are only recomputed, if the output moved to a CRTC with
+ * a different gamma size. The gamma size is only queried again after
+ * daemon_event() dropped it.
+ */
+void
+daemon_apply(xcalib_display_t * display, xcalib_resident_t * resident, int nresident,
+             const xcalib_state_t * defaults, const char * cache_dir, int invert)
+{
+  Display * dpy = xcalib_display_x11( display );
+  int i;
+
+  for(i = 0; i < nresident; ++i)
+  {
+    xcalib_resident_t * r = &resident[i];
+    int size, ret;
+
+    if(r->display != display || !r->pending)
+      continue;
+    r->pending = 0;
+
+    if(!r->gamma_size)
+      r->gamma_size = XRRGetCrtcGammaSize( dpy, r->crtc );
+    size = r->gamma_size;
+    if(!r->ramp || (int)r->ramp->size != size)
+    {
+      xcalib_ramp_t * ramp = xcalib_ramp_size_supported(size) ?
+                             xcalib_ramp_new(size) : NULL;
+      if(!ramp ||
+         batch_line_ramps(r->line, defaults, cache_dir, invert, ramp) <= 0)
+      {
+        warning ("Unable to load \"%s\" with %d entries for output \"%s\"",
+                 r->line->profile, size, r->line->output);
+        xcalib_ramp_release(&ramp);
+        continue;
+      }
+      xcalib_ramp_release(&r->ramp);
+      r->ramp = ramp;
+    }
+
+    ret = xcalib_xrr_apply(display, r->crtc, r->ramp);
+    if(ret < 0)
+      warning ("Unable to calibrate output \"%s\" on display \"%s\"",
+               r->line->output, r->line->display);
+    else
+      message ("%s %s: %s %s", r->line->display, r->line->output,
+               ret ? "unchanged" : "reapplied", r->line->profile);
+  }
+  XFlush( dpy );
+}
+
+/*
+ * FUNCTION run_daemon
+ *
+ * waits for RandR output and CRTC changes on all open displays and
+ * reapplies the resident ramps, until SIGINT or SIGTERM arrive
+ */
+void
+run_daemon(xcalib_display_t ** displays, int ndpys, xcalib_resident_t * resident, int nresident,
+           const xcalib_state_t * defaults, const char * cache_dir, int invert)
+{
+  Display ** dpys = (Display **) calloc (ndpys > 0 ? ndpys : 1, sizeof (Display *));
+  int * event_base = (int *) calloc (ndpys > 0 ? ndpys : 1, sizeof (int));
+  XRRScreenResources ** res = (XRRScreenResources **) calloc (ndpys > 0 ? ndpys : 1,
+                                                  sizeof (XRRScreenResources *));
+  int i, error_base = 0;
+
+  if(!dpys || !event_base || !res)
+  {
+    free(dpys);
+    free(event_base);
+    free(res);
+    return;
+  }
+
+  /* the batch keeps only X connections resident */
+  for(i = 0; i < ndpys; ++i)
+  {
+    dpys[i] = xcalib_display_x11( displays[i] );
+    XRRQueryExtension( dpys[i], &event_base[i], &error_base );
+    XRRSelectInput( dpys[i], DefaultRootWindow( dpys[i] ),
+                    RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask |
+                    RROutputChangeNotifyMask );
+    XFlush( dpys[i] );
+  }
+
+  signal( SIGINT, daemon_signal );
+  signal( SIGTERM, daemon_signal );
+  message ("daemon: watching %d outputs on %d displays", nresident, ndpys);
+
+  while(!daemon_stop)
+  {
+    fd_set fds;
+    int max_fd = -1, queued = 0;
+
+    FD_ZERO( &fds );
+    for(i = 0; i < ndpys; ++i)
+    {
+      while(XPending( dpys[i] ))
+      {
+        XEvent ev;
+        XNextEvent( dpys[i], &ev );
+        daemon_event( displays[i], event_base[i], &ev, &res[i], resident, nresident );
+      }
+      daemon_apply( displays[i], resident, nresident, defaults, cache_dir, invert );
+      /* the replies read by daemon_apply() can bring events along */
+      if(XEventsQueued( dpys[i], QueuedAlready ))
+        queued = 1;
+
+      FD_SET( ConnectionNumber( dpys[i] ), &fds );
+      if(ConnectionNumber( dpys[i] ) > max_fd)
+        max_fd = ConnectionNumber( dpys[i] );
+    }
+
+    if(queued)
+      continue;
+    if(select( max_fd + 1, &fds, NULL, NULL, NULL ) < 0 && errno != EINTR)
+      break;
+  }
+
+  for(i = 0; i < ndpys; ++i)
+    if(res[i])
+      XRRFreeScreenResources( res[i] );
+  free(res);
+  free(event_base);
+  free(dpys);
+}
+
+/*
+ * FUNCTION read_list
+ *
+ * reads the lines of a file or of stdin ("-")
+ *
+ * returns 0 on success, otherwise 1
+ */
+int
+read_list(const char * list_name, char *** lines, int * nlines)
+{
+  FILE * fp = NULL;
+  char * text = NULL;
+  int size = 0;
+
+  *lines = NULL;
+  *nlines = 0;
+  if(strcmp(list_name, "-") == 0)
+    fp = stdin;
+  else
+    fp = fopen(list_name, "r");
+  if(!fp)
+  {
+    error ("Can't open list \"%s\": %s", list_name, strerror(errno));
+    return 1;
+  }
+  text = oyjlReadFileStreamToMem(fp, &size);
+  if(fp != stdin)
+    fclose(fp);
+  if(text)
+    *lines = oyjlStringSplit2(text, "\n", NULL, nlines, NULL, malloc);
+  free(text);
+
+  return 0;
+}
+
+/*
+ * FUNCTION run_batch
+ *
+ * applies a list of assignments read from a file or from stdin ("-").
+ * Each line contains
+ *   DISPLAY OUTPUT PROFILE [GAMMA [BRIGHTNESS [CONTRAST]]]
+ * DISPLAY "-" uses the -d option or $DISPLAY; OUTPUT is the index as for
+ * -o or a XRandR output name; PROFILE "-" resets the output to linear.
+ * Empty lines and lines starting with '#' are skipped.
+ * All lines for one display share one connection and one query of
+ * the screen resources.
+ * defaults carries the command line corrections and verbosity; each
+ * line computes its ramps from a copy of it.
+ * With daemon set the connections stay open and the computed ramps are
+ * kept to reapply them on RandR hotplug and mode set events.
+ *
+ * returns the number of failed lines
+ */
+int
+run_batch(const char * list_name, const char * default_display,
+          const xcalib_state_t * defaults, const char * cache_dir,
+          int invert, int donothing, int daemon)
+{
+  char ** lines = NULL;
+  xcalib_batch_t * batch = NULL;
+  xcalib_resident_t * resident = NULL;
+  xcalib_display_t ** displays = NULL;
+  int nlines = 0, n = 0, i, j, failed = 0, nresident = 0, ndpys = 0;
+
+  if(read_list(list_name, &lines, &nlines))
+    return 1;
+  if(nlines)
+  {
+    batch = (xcalib_batch_t *) calloc (nlines, sizeof (xcalib_batch_t));
+    resident = (xcalib_resident_t *) calloc (nlines, sizeof (xcalib_resident_t));
+    displays = (xcalib_display_t **) calloc (nlines, sizeof (xcalib_display_t *));
+  }
+
+  for(i = 0; batch && i < nlines; ++i)
+  {
+    xcalib_batch_t * b = &batch[n];
+    const char * line = lines[i];
+    int fields;
+    while(isspace((unsigned char)*line))
+      ++line;
+    if(!line[0] || line[0] == '#')
+      continue;
+    b->brightness = -1.0;
+    fields = sscanf(line, "%255s %63s %4095s %lf %lf %lf", b->display, b->output,
+                    b->profile, &b->gamma_, &b->brightness, &b->contrast);
+    if(fields < 3)
+    {
+      warning ("batch line %d: expected DISPLAY OUTPUT PROFILE [GAMMA [BRIGHTNESS [CONTRAST]]]: %s", i+1, line);
+      ++failed;
+      continue;
+    }
+    if(strcmp(b->display, "-") == 0)
+    {
+      const char * d = default_display && default_display[0] ? default_display : getenv("DISPLAY");
+      snprintf(b->display, sizeof(b->display), "%s", d ? d : "");
+    }
+    ++n;
+  }
+  oyjlStringListRelease(&lines, nlines, free);
+
+  if(!resident || !displays)
+    daemon = 0;
+
+  /* one connection per display */
+  for(i = 0; i < n; ++i)
+  {
+    xcalib_display_t * display;
+    xcalib_output_t * outputs = NULL;
+    int noutputs = 0, xrr_version, resident_dpy;
+
+    if(batch[i].done)
+      continue;
+
+    display = xcalib_display_open(batch[i].display);
+    /* the daemon waits for XRandR events, which only a X connection has */
+    resident_dpy = daemon && xcalib_display_x11(display);
+    if(display)
+    {
+      xrr_version = xcalib_xrr_version( display );
+      if(xrr_version >= 102)
+        noutputs = xcalib_xrr_get_outputs( display, default_screen(display), xrr_version, &outputs );
+      else
+        warning ("XRandR 1.2 is needed for batch mode on \"%s\"", batch[i].display);
+    } else
+      warning ("Can't open display \"%s\"", batch[i].display);
+
+    for(j = i; j < n; ++j)
+    {
+      xcalib_batch_t * b = &batch[j];
+      xcalib_output_t * out;
+      xcalib_ramp_t * ramp;
+      int ret;
+
+      if(b->done || strcmp(b->display, batch[i].display) != 0)
+        continue;
+      b->done = 1;
+
+      if(!noutputs)
+      {
+        ++failed;
+        continue;
+      }
+      out = xcalib_xrr_find_output(outputs, noutputs, b->output);
+      if(!out || !xcalib_ramp_size_supported(out->gamma_size))
+      {
+        warning ("no usable output \"%s\" on display \"%s\"", b->output, b->display);
+        ++failed;
+        /* wait for a output of that name to be plugged in */
+        if(resident_dpy && !out)
+        {
+          resident[nresident].display = display;
+          resident[nresident++].line = b;
+        }
+        continue;
+      }
+
+      ramp = xcalib_ramp_new(out->gamma_size);
+      if(!ramp)
+      {
+        ++failed;
+        continue;
+      }
+
+      ret = batch_line_ramps(b, defaults, cache_dir, invert, ramp);
+
+      if(ret <= 0)
+      {
+        warning ("Unable to load \"%s\" for output \"%s\" on display \"%s\"",
+                 b->profile, out->name, b->display);
+        ++failed;
+      }
+      else
+      {
+        if(!donothing)
+          ret = xcalib_xrr_apply(display, out->crtc, ramp);
+        message ("%s %s (%d entries): %s%s", b->display, out->name, out->gamma_size, b->profile,
+                 donothing ? "" : ret == 1 ? " unchanged" : " written");
+        if(!donothing && ret < 0)
+        {
+          warning ("Unable to calibrate output \"%s\" on display \"%s\"", out->name, b->display);
+          ++failed;
+        }
+        else if(resident_dpy)
+        {
+          xcalib_resident_t * r = &resident[nresident++];
+          r->display = display;
+          r->line = b;
+          r->output = out->output;
+          r->crtc = out->crtc;
+          r->gamma_size = out->gamma_size;
+          r->ramp = ramp;
+          ramp = NULL;
+        }
+      }
+      xcalib_ramp_release(&ramp);
+    }
+
+    free(outputs);
+    if(resident_dpy)
+      displays[ndpys++] = display;
+    else if(display)
+      xcalib_display_close(display);
+  }
+
+  if(daemon && ndpys)
+    run_daemon(displays, ndpys, resident, nresident, defaults, cache_dir, invert);
+
+  for(i = 0; i < ndpys; ++i)
+    xcalib_display_close(displays[i]);
+  for(i = 0; i < nresident; ++i)
+    xcalib_ramp_release(&resident[i].ramp);
+  free(displays);
+  free(resident);
+  free(batch);
+
+  return failed;
+}
+
+/* ramps of one profile and correction, computed once per gamma size */
+typedef struct {
+  xcalib_ramp_t ** ramps;
+  int * loaded;                /* result of computing ramps[i] */
+  int nramps;
+  int reserved;
+  const char * profile;        /* NULL resets the outputs */
+  const xcalib_state_t * state;
+  const char * cache_dir;
+  int correction;
+  int invert;
+} xcalib_ramp_table_t;
+
+/*
+ * FUNCTION ramp_table_reserve
+ *
+ * makes room for one more ramp size
+ *
+ * returns 0 on success, otherwise -1
+ */
+int
+ramp_table_reserve(xcalib_ramp_table_t * table)
+{
+  int n = table->reserved ? table->reserved * 2 : 4;
+  xcalib_ramp_t ** ramps;
+  int * loaded;
+
+  if(table->nramps < table->reserved)
+    return 0;
+  ramps = (xcalib_ramp_t **) realloc (table->ramps, n * sizeof (xcalib_ramp_t *));
+  if(ramps)
+    table->ramps = ramps;
+  loaded = (int *) realloc (table->loaded, n * sizeof (int));
+  if(loaded)
+    table->loaded = loaded;
+  if(!ramps || !loaded)
+    return -1;
+  table->reserved = n;
+
+  return 0;
+}
+
+/*
+ * FUNCTION ramp_table_find
+ *
+ * returns the index of the ramps for a gamma size or -1
+ */
+int
+ramp_table_find(const xcalib_ramp_table_t * table, int size)
+{
+  int i;
+
+  for(i = 0; i < table->nramps; ++i)
+    if((int)table->ramps[i]->size == size)
+      return i;
+
+  return -1;
+}
+
+/*
+ * FUNCTION ramp_table_compute
+ *
+ * computes the ramps for a gamma size from the table parameters
+ * without touching the table itself; *ret is the result of
+ * xcalib_ramp_load()
+ *
+ * returns the new ramps or NULL on allocation error
+ */
+xcalib_ramp_t *
+ramp_table_compute(const xcalib_ramp_table_t * table, int size, int * ret)
+{
+  xcalib_ramp_t * ramp = xcalib_ramp_new(size);
+
+  *ret = -1;
+  if(!ramp)
+    return NULL;
+  if(table->profile)
+    *ret = xcalib_ramp_load(ramp, table->profile, table->cache_dir,
+                            table->correction, table->invert, table->state);
+  else
+  {
+    linear_ramp(ramp);
+    *ret = 1;
+  }
+
+  return ramp;
+}
+
+/*
+ * FUNCTION ramp_table_insert
+ *
+ * stores computed ramps, also failed ones, so they are not retried
+ *
+ * returns the index or -1 on error; then the ramps are released
+ */
+int
+ramp_table_insert(xcalib_ramp_table_t * table, xcalib_ramp_t * ramp, int ret)
+{
+  if(!ramp || ramp_table_reserve(table))
+  {
+    xcalib_ramp_release(&ramp);
+    return -1;
+  }
+  table->ramps[table->nramps] = ramp;
+  table->loaded[table->nramps] = ret;
+
+  return table->nramps++;
+}
+
+/*
+ * FUNCTION ramp_table_get
+ *
+ * looks up the ramps for a gamma size and computes them on first use.
+ * The ramps are not changed afterwards.
+ *
+ * returns the ramps or NULL on error
+ */
+const xcalib_ramp_t *
+ramp_table_get(xcalib_ramp_table_t * table, int size)
+{
+  int i = ramp_table_find(table, size), ret;
+
+  if(i < 0)
+  {
+    xcalib_ramp_t * ramp = ramp_table_compute(table, size, &ret);
+    i = ramp_table_insert(table, ramp, ret);
+  }
+
+  return i >= 0 && table->loaded[i] > 0 ? table->ramps[i] : NULL;
+}
+
+/*
+ * FUNCTION ramp_table_release
+ *
+ * frees all ramps of the table
+ */
+void
+ramp_table_release(xcalib_ramp_table_t * table)
+{
+  int i;
+
+  for(i = 0; i < table->nramps; ++i)
+    xcalib_ramp_release(&table->ramps[i]);
+  free(table->ramps);
+  free(table->loaded);
+  table->ramps = NULL;
+  table->loaded = NULL;
+  table->nramps = table->reserved = 0;
+}
+
+/*
+ * FUNCTION apply_outputs
+ *
+ * calibrates several outputs of one display. selection is a comma
+ * separated list of output numbers or names as for -o; NULL takes all
+ * active outputs. Outputs of the same gamma size share one table.
+ * With fade the changed outputs are faded in step over fade ms.
+ *
+ * returns the number of failed outputs
+ */
+int
+apply_outputs(xcalib_display_t * display, xcalib_output_t * outputs, int n,
+              const char * selection, xcalib_ramp_table_t * table,
+              int donothing, double fade, double fps)
+{
+  char * selected = (char *) calloc (n + 1, sizeof (char));
+  RRCrtc * crtcs = (RRCrtc *) calloc (n + 1, sizeof (RRCrtc));
+  const xcalib_ramp_t ** ramps = (const xcalib_ramp_t **) calloc (n + 1, sizeof (xcalib_ramp_t *));
+  int i, failed = 0, nfade = 0;
+
+  if(!selected || !crtcs || !ramps)
+  {
+    free(selected);
+    free(crtcs);
+    free(ramps);
+    return n ? n : 1;
+  }
+
+  if(selection)
+  {
+    int count = 0;
+    char ** list = oyjlStringSplit2(selection, ",", NULL, &count, NULL, malloc);
+    for(i = 0; i < count; ++i)
+    {
+      xcalib_output_t * out = xcalib_xrr_find_output(outputs, n, list[i]);
+      if(out)
+        selected[out - outputs] = 1;
+      else
+      {
+        warning ("no active output \"%s\"", list[i]);
+        ++failed;
+      }
+    }
+    oyjlStringListRelease(&list, count, free);
+  }
+  else
+    memset(selected, 1, n);
+
+  for(i = 0; i < n; ++i)
+  {
+    const xcalib_ramp_t * ramp;
+    int ret = 0;
+
+    if(!selected[i])
+      continue;
+    if(!xcalib_ramp_size_supported(outputs[i].gamma_size))
+    {
+      warning ("unsupported ramp size %d of output \"%s\"", outputs[i].gamma_size, outputs[i].name);
+      ++failed;
+      continue;
+    }
+    ramp = ramp_table_get(table, outputs[i].gamma_size);
+    if(!ramp)
+    {
+      warning ("Unable to load \"%s\" for output \"%s\"",
+               table->profile ? table->profile : "-", outputs[i].name);
+      ++failed;
+      continue;
+    }
+    if(!donothing && fade > 0.0)
+    {
+      /* collect the changed outputs for one fade */
+      if(xcalib_xrr_ramp_equal(display, outputs[i].crtc, ramp))
+        ret = 1;
+      else
+      {
+        crtcs[nfade] = outputs[i].crtc;
+        ramps[nfade++] = ramp;
+        continue;
+      }
+    }
+    else if(!donothing)
+      ret = xcalib_xrr_apply(display, outputs[i].crtc, ramp);
+    message ("%s (%d entries): %s%s", outputs[i].name, outputs[i].gamma_size,
+             table->profile ? table->profile : "-",
+             donothing ? "" : ret == 1 ? " unchanged" : ret < 0 ? " failed" : " written");
+    if(ret < 0)
+    {
+      warning ("Unable to calibrate output \"%s\"", outputs[i].name);
+      ++failed;
+    }
+  }
+  if(nfade)
+  {
+    double start = xcalib_time_ms();
+    int frames = xcalib_xrr_fade_crtcs(display, nfade, crtcs, ramps, fade, fps);
+
+    if(frames < 0)
+    {
+      warning ("Unable to fade %d outputs", nfade);
+      failed += nfade;
+    }
+    else
+      message ("%d outputs faded in %d frames in %.0f ms", nfade, frames, xcalib_time_ms() - start);
+  }
+  message ("%d ramp sizes for the outputs", table->nramps);
+  free(selected);
+  free(crtcs);
+  free(ramps);
+
+  return failed;
+}
 
-#ifdef _WIN32
-/* Win32 monitor enumeration - code by gl.tter ( http://gl.tter.org ) */
-static unsigned int monitorSearchIndex = 0;
-static HDC monitorDC = 0;
+/* one display of a fleet list */
+typedef struct {
+  char display[256];
+  double ms;                   /* connect to last upload */
+  int outputs;                 /* calibrated outputs */
+  int unchanged;               /* outputs, which had the ramps already */
+  const char * failure;        /* NULL on success */
+} xcalib_fleet_t;
+
+/* work shared by the fleet workers */
+typedef struct {
+  pthread_mutex_t lock;        /* guards next and the ramps */
+  xcalib_fleet_t * displays;
+  int ndisplays;
+  int next;
+  xcalib_ramp_table_t table;
+  const char * output;         /* NULL takes all active outputs */
+  int donothing;
+} xcalib_fleet_pool_t;
 
 /*
- * FUNCTION MonitorEnumProc
+ * FUNCTION fleet_ramp
  *
- * this is a Win32 callback function which is given as an argument
- * to EnumDisplayMonitors.
+ * looks up the shared ramps for a gamma size. Missing ramps are parsed
+ * and corrected outside of the lock, so workers needing different
+ * sizes do not wait for each other; if two workers compute the same
+ * size, the first insert wins. The ramps are not changed after
+ * computing them and can be read without lock.
  *
- * returns
- * TRUE: if the current enumerated display is the wrong one
- * FALSE: if the right monitor was found and the DC was associated
+ * returns the ramps or NULL on error
  */
-BOOL CALLBACK MonitorEnumProc (HMONITOR monitor, HDC hdc, LPRECT rect, LPARAM data)
+const xcalib_ramp_t *
+fleet_ramp(xcalib_fleet_pool_t * pool, int size)
 {
-  MONITORINFOEX monitorInfo;
-  
-  if(monitorSearchIndex++ != (unsigned int)data)
-    return TRUE; /* continue enumeration */
-  
-  monitorInfo.cbSize = sizeof(monitorInfo);
-  if(GetMonitorInfo(monitor, (LPMONITORINFO)&monitorInfo) )
-    monitorDC = CreateDC(NULL, monitorInfo.szDevice, NULL, NULL);
-  
-  return FALSE;  /* stop enumeration */
+  const xcalib_ramp_t * ramp = NULL;
+  xcalib_ramp_t * computed;
+  int i, ret;
+
+  pthread_mutex_lock(&pool->lock);
+  i = ramp_table_find(&pool->table, size);
+  if(i >= 0 && pool->table.loaded[i] > 0)
+    ramp = pool->table.ramps[i];
+  pthread_mutex_unlock(&pool->lock);
+  if(i >= 0)
+    return ramp;
+
+  computed = ramp_table_compute(&pool->table, size, &ret);
+
+  pthread_mutex_lock(&pool->lock);
+  i = ramp_table_find(&pool->table, size);
+  if(i < 0)
+    i = ramp_table_insert(&pool->table, computed, ret);
+  else
+    xcalib_ramp_release(&computed);
+  if(i >= 0 && pool->table.loaded[i] > 0)
+    ramp = pool->table.ramps[i];
+  pthread_mutex_unlock(&pool->lock);
+
+  return ramp;
 }
 
 /*
- * FUNCTION FindMonitor
- *
- * find a specific monitor given by index. Index -1 is the
- * primary display.
+ * FUNCTION fleet_display
  *
- * returns the DC of the selected monitor
+ * connects to one display of the fleet and uploads the ramps to the
+ * selected outputs. Failures are recorded in f and reported by the
+ * caller in list order; the library messages of the ramp computation
+ * go through the serialised myMessage().
  */
-HDC FindMonitor(int index)
+void
+fleet_display(xcalib_fleet_pool_t * pool, xcalib_fleet_t * f)
 {
-  if(index == -1)
-    return GetDC(NULL); /* return primary display context */
+  double start = xcalib_time_ms();
+  xcalib_output_t * outputs = NULL, * out;
+  xcalib_display_t * display = xcalib_display_open(f->display);
+  int noutputs = 0, xrr_version, i;
 
-  monitorSearchIndex = 0;
-  monitorDC = 0;
-  EnumDisplayMonitors(NULL, NULL, MonitorEnumProc, index);
-  return monitorDC;
-}
+  if(!display)
+  {
+    f->failure = "can't open display";
+    f->ms = xcalib_time_ms() - start;
+    return;
+  }
 
-#endif
+  xrr_version = xcalib_xrr_version( display );
+  if(xrr_version >= 102)
+    noutputs = xcalib_xrr_get_outputs( display, default_screen(display), xrr_version, &outputs );
+  else
+    f->failure = "XRandR 1.2 is needed";
+
+  out = pool->output ? xcalib_xrr_find_output(outputs, noutputs, pool->output) : NULL;
+  if(pool->output && noutputs && !out)
+    f->failure = "no usable output";
+  for(i = 0; i < noutputs && !f->failure; ++i)
+  {
+    const xcalib_ramp_t * ramp;
+    int ret = 0;
 
-float        LinInterpolateRampU16   ( unsigned short    * ramp,
-                                       int                 ramp_size,
-                                       float               pos )
-{
-  unsigned short val1, val2;
-  float start, dist, result;
-  
-  if(!ramp)
-    return 0.0;
-  
-  if(pos < 0)
-    return ramp[0];
-    
-  if(pos > ramp_size-1)
-    return ramp[ramp_size-1];
-  
-  dist = modff( pos, &start );
-  val1 = ramp[(int)start];
-  val2 = ramp[(int)start+1];
-    
-  result = val2 - val1;
-  result *= dist;
-  result += val1;
-    
-  return result;
+    if(out && out != &outputs[i])
+      continue;
+    if(!xcalib_ramp_size_supported(outputs[i].gamma_size))
+    {
+      if(out)
+        f->failure = "no usable output";
+      continue;
+    }
+    ramp = fleet_ramp(pool, outputs[i].gamma_size);
+    if(!ramp)
+      f->failure = "unable to load the profile";
+    else if(!pool->donothing && (ret = xcalib_xrr_apply(display, outputs[i].crtc, ramp)) < 0)
+      f->failure = "unable to set the gamma ramps";
+    else
+    {
+      ++f->outputs;
+      if(ret == 1)
+        ++f->unchanged;
+    }
+  }
+  if(!f->failure && !f->outputs)
+    f->failure = "no usable output";
+
+  free(outputs);
+  xcalib_display_close(display);
+  f->ms = xcalib_time_ms() - start;
 }
 
+/*
+ * FUNCTION fleet_worker
+ *
+ * takes displays from the pool until all are done
+ */
+void *
+fleet_worker(void * arg)
+{
+  xcalib_fleet_pool_t * pool = (xcalib_fleet_pool_t *) arg;
+
+  for(;;)
+  {
+    int i;
+
+    pthread_mutex_lock(&pool->lock);
+    i = pool->next++;
+    pthread_mutex_unlock(&pool->lock);
+    if(i >= pool->ndisplays)
+      break;
+    fleet_display(pool, &pool->displays[i]);
+  }
+
+  return NULL;
+}
 
 /*
- * FUNCTION read_vcgt_internal
+ * FUNCTION run_fleet
  *
- * this is a parser for the vcgt tag of ICC profiles which tries to
- * resemble most of the functionality of Graeme Gill's icclib.
+ * applies one profile to many X displays. The list file or stdin ("-")
+ * contains one DISPLAY per line; empty lines and lines starting with
+ * '#' are skipped. A pool of jobs workers opens the connections
+ * concurrently, 0 jobs takes the number of online CPUs. The ramps are
+ * computed once per gamma size and shared by all workers.
+ * Prints one line per display with the time from connecting to the
+ * last upload.
  *
- * returns
- * -1: file could not be read
- * 0: file okay but doesn't contain vcgt or MLUT tag
- * 1: success
+ * returns the number of failed displays
  */
 int
-read_vcgt_internal(const char * filename, u_int16_t * rRamp, u_int16_t * gRamp,
-		       u_int16_t * bRamp, unsigned int nEntries)
+run_fleet(const char * list_name, const char * profile, const char * output,
+          const xcalib_state_t * state, const char * cache_dir,
+          int correction, int invert, int donothing, int jobs)
 {
-  FILE * fp;
-  unsigned int bytesRead;
-  unsigned int numTags=0;
-  unsigned int tagName=0;
-  unsigned int tagOffset=0;
-  unsigned int tagSize=0;
-  unsigned char cTmp[4];
-  unsigned int uTmp;
-  unsigned int gammaType;
-
-  signed int retVal=0;
-
-  u_int16_t * redRamp = NULL, * greenRamp = NULL, * blueRamp = NULL;
-  unsigned int ratio=0;
-  /* formula */
-  float rGamma, rMin, rMax;
-  float gGamma, gMin, gMax;
-  float bGamma, bMin, bMax;
-  int i=0;
-  /* table */
-  unsigned int numChannels=0;
-  unsigned int numEntries=0;
-  unsigned int entrySize=0;
-  int j=0;
-
-  if(filename) {
-    fp = fopen(filename, "rb");
-    if(!fp)
-      return -1; /* file can not be opened */
-  } else
-    return -1; /* filename char pointer not valid */
-  /* skip header */
-  if(fseek(fp, 0+128, SEEK_SET))
-    return  -1;
-  /* check num of tags in current profile */
-  bytesRead = fread(cTmp, 1, 4, fp);
-  numTags = BE_INT(cTmp);
-  for(i=0; i<numTags; i++) {
-    bytesRead = fread(cTmp, 1, 4, fp);
-    tagName = BE_INT(cTmp);
-    bytesRead = fread(cTmp, 1, 4, fp);
-    tagOffset = BE_INT(cTmp); 
-    bytesRead = fread(cTmp, 1, 4, fp);
-    tagSize = BE_INT(cTmp);
-    if(!bytesRead)
-      break;
-    if(tagName == MLUT_TAG)
+  xcalib_fleet_pool_t pool;
+  pthread_t * workers = NULL;
+  char ** lines = NULL;
+  int nlines = 0, i, nworkers = 0, failed = 0;
+  double start = xcalib_time_ms();
+
+  if(read_list(list_name, &lines, &nlines))
+    return 1;
+
+  memset(&pool, 0, sizeof(pool));
+  pthread_mutex_init(&pool.lock, NULL);
+  pool.table.profile = profile && profile[0] ? profile : NULL;
+  pool.output = output && output[0] ? output : NULL;
+  pool.table.state = state;
+  pool.table.cache_dir = cache_dir;
+  pool.table.correction = correction;
+  pool.table.invert = invert;
+  pool.donothing = donothing;
+  if(nlines)
+    pool.displays = (xcalib_fleet_t *) calloc (nlines, sizeof (xcalib_fleet_t));
+  for(i = 0; pool.displays && i < nlines; ++i)
+  {
+    const char * line = lines[i];
+    while(isspace((unsigned char)*line))
+      ++line;
+    if(!line[0] || line[0] == '#')
+      continue;
+    sscanf(line, "%255s", pool.displays[pool.ndisplays++].display);
+  }
+  oyjlStringListRelease(&lines, nlines, free);
+
+  if(jobs <= 0)
+    jobs = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  if(jobs > pool.ndisplays)
+    jobs = pool.ndisplays;
+  if(jobs < 1)
+    jobs = 1;
+
+  /* the connections are private to each worker, but Xlib shares some
+   * state between them */
+  XInitThreads();
+  workers = (pthread_t *) calloc (jobs, sizeof (pthread_t));
+  for(i = 0; workers && i < jobs; ++i)
+    if(pthread_create(&workers[nworkers], NULL, fleet_worker, &pool) == 0)
+      ++nworkers;
+  /* work in this thread, if no worker could be started */
+  if(!nworkers)
+    fleet_worker(&pool);
+  for(i = 0; i < nworkers; ++i)
+    pthread_join(workers[i], NULL);
+
+  for(i = 0; i < pool.ndisplays; ++i)
+  {
+    xcalib_fleet_t * f = &pool.displays[i];
+    if(f->failure)
     {
-      if(fseek(fp, 0+tagOffset, SEEK_SET))
-        break;
-      message("mLUT found (Profile Mechanic) %s", filename);
-      redRamp = (unsigned short *) malloc ((256) * sizeof (unsigned short));
-      greenRamp = (unsigned short *) malloc ((256) * sizeof (unsigned short));
-      blueRamp = (unsigned short *) malloc ((256) * sizeof (unsigned short));
-      {
-        for(j=0; j<256; j++) {
-          bytesRead = fread(cTmp, 1, 2, fp);
-          redRamp[j]= BE_SHORT(cTmp);
-        }
-        for(j=0; j<256; j++) {
-          bytesRead = fread(cTmp, 1, 2, fp);
-          greenRamp[j]= BE_SHORT(cTmp);
-        }
-        for(j=0; j<256; j++) {
-          bytesRead = fread(cTmp, 1, 2, fp);
-          blueRamp[j]= BE_SHORT(cTmp);
-        }
-      }
-      /* simply copy values to the external table (and leave some values out if table size < 256) */
-      ratio = (unsigned int)(256 / (nEntries));
-      for(j=0; j<nEntries; j++)
-      {
-        rRamp[j] = redRamp[ratio*j];
-        gRamp[j] = greenRamp[ratio*j];
-        bRamp[j] = blueRamp[ratio*j];
-      }
-      free(redRamp);
-      free(greenRamp);
-      free(blueRamp);
-      retVal = 1;
-      break;
+      warning ("%s: %s", f->display, f->failure);
+      ++failed;
     }
-    if(tagName == VCGT_TAG)
-    {
-      fseek(fp, 0+tagOffset, SEEK_SET);
-      message("vcgt found %s", filename);
-      bytesRead = fread(cTmp, 1, 4, fp);
-      tagName = BE_INT(cTmp);
-      if(tagName != VCGT_TAG)
-      {
-        warning("invalid content of table vcgt, starting with %x",
-              tagName);
-        break;
-      }
-      bytesRead = fread(cTmp, 1, 4, fp);
-      bytesRead = fread(cTmp, 1, 4, fp);
-      gammaType = BE_INT(cTmp);
-      /* VideoCardGammaFormula */
-      if(gammaType==1)
-      {
-        bytesRead = fread(cTmp, 1, 4, fp);
-        uTmp = BE_INT(cTmp);
-        rGamma = (float)uTmp/65536.0;
-        bytesRead = fread(cTmp, 1, 4, fp);
-        uTmp = BE_INT(cTmp);
-        rMin = (float)uTmp/65536.0;
-        bytesRead = fread(cTmp, 1, 4, fp);
-        uTmp = BE_INT(cTmp);
-        rMax = (float)uTmp/65536.0;
-        bytesRead = fread(cTmp, 1, 4, fp);
-        uTmp = BE_INT(cTmp);
-        gGamma = (float)uTmp/65536.0;
-        bytesRead = fread(cTmp, 1, 4, fp);
-        uTmp = BE_INT(cTmp);
-        gMin = (float)uTmp/65536.0;
-        bytesRead = fread(cTmp, 1, 4, fp);
-        uTmp = BE_INT(cTmp);
-        gMax = (float)uTmp/65536.0;
-        bytesRead = fread(cTmp, 1, 4, fp);
-        uTmp = BE_INT(cTmp);
-        bGamma = (float)uTmp/65536.0;
-        bytesRead = fread(cTmp, 1, 4, fp);
-        uTmp = BE_INT(cTmp);
-        bMin = (float)uTmp/65536.0;
-        bytesRead = fread(cTmp, 1, 4, fp);
-        uTmp = BE_INT(cTmp);
-        bMax = (float)uTmp/65536.0;
-
-        if(rGamma > 5.0 || gGamma > 5.0 || bGamma > 5.0)
-        {
-          warning("Gamma values out of range (> 5.0): \nR: %f \tG: %f \t B: %f",
-                rGamma, gGamma, bGamma);
-          break;
-        }
-        if(rMin >= 1.0 || gMin >= 1.0 || bMin >= 1.0)
-        {
-          warning("Gamma lower limit out of range (>= 1.0): \nRMin: %f \tGMin: %f \t BMin: %f",
-                rMin, gMin, bMin);
-          break;
-        }
-        if(rMax > 1.0 || gMax > 1.0 || bMax > 1.0)
-        {
-          warning("Gamma upper limit out of range (> 1.0): \nRMax: %f \tGMax: %f \t BMax: %f",
-                rMax, gMax, bMax);
-          break;
-        }
-        message("Red:   Gamma %f \tMin %f \tMax %f", rGamma, rMin, rMax);
-        message("Green: Gamma %f \tMin %f \tMax %f", gGamma, gMin, gMax);
-        message("Blue:  Gamma %f \tMin %f \tMax %f", bGamma, bMin, bMax);
+    fprintf(stdout, "%s\t%.2f ms\t%d outputs\t%d unchanged%s%s\n", f->display, f->ms,
+            f->outputs, f->unchanged, f->failure ? "\t" : "", f->failure ? f->failure : "");
+  }
+  message ("fleet: %d displays, %d failed, %d workers, %d ramp sizes, %.2f ms",
+           pool.ndisplays, failed, nworkers ? nworkers : 1, pool.table.nramps, xcalib_time_ms() - start);
 
-        for(j=0; j<nEntries; j++)
-        {
-          rRamp[j] = 65536.0 *
-            ((double) pow ((double) j / (double) (nEntries),
-                           rGamma * (double) xcalib_state.gamma_cor 
-                          ) * (rMax - rMin) + rMin);
-          gRamp[j] = 65536.0 *
-            ((double) pow ((double) j / (double) (nEntries),
-                           gGamma * (double) xcalib_state.gamma_cor
-                          ) * (gMax - gMin) + gMin);
-          bRamp[j] = 65536.0 *
-            ((double) pow ((double) j / (double) (nEntries),
-                           bGamma * (double) xcalib_state.gamma_cor
-                          ) * (bMax - bMin) + bMin);
-        }
-        retVal = 1;
-      }
-      /* VideoCardGammaTable */
-      else if(gammaType==0)
-      {
-        bytesRead = fread(cTmp, 1, 2, fp);
-        numChannels = BE_SHORT(cTmp);
-        bytesRead = fread(cTmp, 1, 2, fp);
-        numEntries = BE_SHORT(cTmp);
-        bytesRead = fread(cTmp, 1, 2, fp);
-        entrySize = BE_SHORT(cTmp);
-
-        /* work-around for AdobeGamma-Profiles */
-        if(tagSize == 1584) {
-          entrySize = 2;
-          numEntries = 256;
-          numChannels = 3;
-        }
+  ramp_table_release(&pool.table);
+  free(pool.displays);
+  free(workers);
+  pthread_mutex_destroy(&pool.lock);
 
-        message ("channels:        \t%d", numChannels);
-        message ("entry size:      \t%dbits",entrySize  * 8);
-        message ("entries/channel: \t%d", numEntries);
-        message ("tag size:        \t%d", tagSize);
-                                                
-        if(numChannels!=3)          /* assume we have always RGB */
-          break;
-
-        /* allocate tables for the file plus one entry for extrapolation */
-        redRamp = (unsigned short *) malloc ((numEntries+1) * sizeof (unsigned short));
-        greenRamp = (unsigned short *) malloc ((numEntries+1) * sizeof (unsigned short));
-        blueRamp = (unsigned short *) malloc ((numEntries+1) * sizeof (unsigned short));
-        {
-          rMax = gMax = bMax = -1;
-          rMin = gMin = bMin = 65536;
-          for(j=0; j<numEntries; j++)
-          {
-            switch(entrySize)
-            {
-              case 1:
-                bytesRead = fread(cTmp, 1, 1, fp);
-                redRamp[j]= cTmp[0] << 8;
-                break;
-              case 2:
-                bytesRead = fread(cTmp, 1, 2, fp);
-                redRamp[j]= BE_SHORT(cTmp);
-                break;
-            }
-            if(rMax < redRamp[j])
-              rMax = redRamp[j];
-            if(rMin > redRamp[j])
-              rMin = redRamp[j];
-          }
-          for(j=0; j<numEntries; j++)
-          {
-            switch(entrySize)
-            {
-              case 1:
-                bytesRead = fread(cTmp, 1, 1, fp);
-                greenRamp[j]= cTmp[0] << 8;
-                break;
-              case 2:
-                bytesRead = fread(cTmp, 1, 2, fp);
-                greenRamp[j]= BE_SHORT(cTmp);
-                break;
-            }
-            if(gMax < greenRamp[j])
-              gMax = greenRamp[j];
-            if(gMin > greenRamp[j])
-              gMin = greenRamp[j];
-          }
-          for(j=0; j<numEntries; j++)
-          {
-            switch(entrySize)
-            {
-              case 1:                bytesRead = fread(cTmp, 1, 1, fp);
-                blueRamp[j]= cTmp[0] << 8;
-                break;
-              case 2:
-                bytesRead = fread(cTmp, 1, 2, fp);
-                blueRamp[j]= BE_SHORT(cTmp);
-                break;
-            }
-            if(bMax < blueRamp[j])
-              bMax = blueRamp[j];
-            if(bMin > blueRamp[j])
-              bMin = blueRamp[j];
-          }
-        }
-        if( abs(rMax-rMin) < 65535/20 &&
-            abs(gMax-gMin) < 65535/20 &&
-            abs(bMax-bMin) < 65535/20
-          )
-        {
-          warning ("Contrast below 5%% in ICC profile '%s'", filename);
-          warning ("min/max for red: %g / %g  green: %g / %g  blue: %g / %g", rMin, rMax, gMin, gMax, bMin, bMax );
-          retVal = -1;
-          break;
-        }
-        
-        if(numEntries >= nEntries) {
-          /* simply subsample if the LUT is smaller than the number of entries in the file */
-          ratio = (unsigned int)(numEntries / (nEntries));
-          for(j=0; j<nEntries; j++) {
-            rRamp[j] = redRamp[ratio*j];
-            gRamp[j] = greenRamp[ratio*j];
-            bRamp[j] = blueRamp[ratio*j];
-          }
-        }
-        else {
-          ratio = (unsigned int)(nEntries / numEntries);
-          /* add extrapolated upper limit to the arrays - handle overflow */
-          redRamp[numEntries] = (redRamp[numEntries-1] + (redRamp[numEntries-1] - redRamp[numEntries-2])) & 0xffff;
-          if(redRamp[numEntries] < 0x4000)
-            redRamp[numEntries] = 0xffff;
-          
-          greenRamp[numEntries] = (greenRamp[numEntries-1] + (greenRamp[numEntries-1] - greenRamp[numEntries-2])) & 0xffff;
-          if(greenRamp[numEntries] < 0x4000)
-            greenRamp[numEntries] = 0xffff;
-          
-          blueRamp[numEntries] = (blueRamp[numEntries-1] + (blueRamp[numEntries-1] - blueRamp[numEntries-2])) & 0xffff;
-          if(blueRamp[numEntries] < 0x4000)
-            blueRamp[numEntries] = 0xffff;
-         
-          for(j=0; j<numEntries; j++) {
-            for(i=0; i<ratio; i++)
-            {
-              rRamp[j*ratio+i] = (int)LinInterpolateRampU16( redRamp, numEntries, (j*ratio+i)*(double)(numEntries-1)/(double)(nEntries-1));
-              gRamp[j*ratio+i] = (int)LinInterpolateRampU16( greenRamp, numEntries, (j*ratio+i)*(double)(numEntries-1)/(double)(nEntries-1));
-              bRamp[j*ratio+i] = (int)LinInterpolateRampU16( blueRamp, numEntries, (j*ratio+i)*(double)(numEntries-1)/(double)(nEntries-1));
-            }
-          }
-        }
-        free(redRamp);
-        free(greenRamp);
-        free(blueRamp);
-        retVal = 1;
-      }
-      break;
-    } /* for all tags */
-  }
-  fclose(fp);
-  return retVal;
+  return failed;
 }
+#endif
 
+#ifndef _WIN32
+static pthread_mutex_t message_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
 int          myMessage               ( int/*oyjlMSG_e*/    error_code,
-                                       const void        * context_object OYJL_UNUSED,
+                                       const void        * context_object,
                                        const char        * format,
                                        ... )
 {
+  const xcalib_state_t * state = (const xcalib_state_t *) context_object;
   int error = 0;
   const char * status_text = NULL;   
 #if !defined (OYJL_ARGS_BASE)          
@@ -560,9 +1487,19 @@ int          myMessage               ( int/*oyjlMSG_e*/    error_code,
   OYJL_CREATE_VA_STRING(format, text, malloc, return 1)    
 #endif /* OYJL_ARGS_BASE */
 
-  if(!xcalib_state.verbose && error_code == oyjlMSG_INFO)
+  if(error_code == oyjlMSG_INFO && !(state ? state->verbose : xcalib_verbose))
+  {
+#if !defined (OYJL_ARGS_BASE)
+    free( text );
+#endif
     return error;
+  }
 
+#ifndef _WIN32
+  /* --fleet workers report through here; oyjlTermColor() uses a
+   * shared buffer and the lines shall not interleave */
+  pthread_mutex_lock( &message_lock );
+#endif
   if(error_code == oyjlMSG_INFO) status_text = oyjlTermColor(oyjlGREEN,"Info: ");
   if(error_code == oyjlMSG_CLIENT_CANCELED) status_text = oyjlTermColor(oyjlBLUE,"Client Canceled: ");
   if(error_code == oyjlMSG_INSUFFICIENT_DATA) status_text = oyjlTermColor(oyjlRED,_("Insufficient Data:"));
@@ -582,6 +1519,9 @@ int          myMessage               ( int/*oyjlMSG_e*/    error_code,
   oyjlArgsBaseLoadCore(); /* how to pass through va_args */
 #endif /* OYJL_ARGS_BASE */            
   fflush( stderr );                    
+#ifndef _WIN32
+  pthread_mutex_unlock( &message_lock );
+#endif
 
   
   return error;
@@ -620,28 +1560,42 @@ static oyjlOptionChoice_s * listInput ( oyjlOption_s * o OYJL_UNUSED, int * y OY
 
   return c;
 }
+#ifndef _WIN32
+static xcalib_display_t * choices_display = NULL;
+/* one lazily opened display shared by all choice providers; a virtual
+ * one lists its outputs without X */
+static xcalib_display_t * choicesDisplay ( oyjlOptions_s * opts )
+{
+  const char * name = NULL;
+
+  if(choices_display)
+    return choices_display;
+
+  if(opts)
+    oyjlOptions_GetResult( opts, "d", &name, 0, 0 );
+  if(name && name[0] && strcmp(name, "oyjl-list") != 0)
+    choices_display = xcalib_display_open( name );
+  if(!choices_display && getenv("DISPLAY"))
+    choices_display = xcalib_display_open( getenv("DISPLAY") );
+
+  return choices_display;
+}
+#endif
 static oyjlOptionChoice_s * listDisplay ( oyjlOption_s * o OYJL_UNUSED, int * y OYJL_UNUSED, oyjlOptions_s * opts OYJL_UNUSED )
 {   
   oyjlOptionChoice_s * c = NULL;
+  const char * display = getenv("DISPLAY");
 
-  int size = 0, i,n = 0;
-  char * result = oyjlReadCommandF( &size, "r", malloc, "echo $DISPLAY" );
-  char ** list = oyjlStringSplit2( result, "\n", NULL, &n, NULL,0 );
-
-  if(list)
+  if(display && display[0])
   {
-    c = calloc(n+1, sizeof(oyjlOptionChoice_s));
+    c = calloc(2, sizeof(oyjlOptionChoice_s));
     if(c)
     {
-      for(i = 0; i < n; ++i)
-      {
-        c[i].nick = strdup( list[i] );
-        c[i].name = strdup("");
-        c[i].description = strdup("");
-        c[i].help = strdup("");
-      }
+      c[0].nick = strdup( display );
+      c[0].name = strdup("");
+      c[0].description = strdup("");
+      c[0].help = strdup("");
     }
-    free(list);
   }
 
   return c;
@@ -649,54 +1603,56 @@ static oyjlOptionChoice_s * listDisplay ( oyjlOption_s * o OYJL_UNUSED, int * y
 static oyjlOptionChoice_s * listScreen ( oyjlOption_s * o OYJL_UNUSED, int * y OYJL_UNUSED, oyjlOptions_s * opts OYJL_UNUSED )
 {   
   oyjlOptionChoice_s * c = NULL;
+#ifndef _WIN32
+  xcalib_display_t * display = choicesDisplay( opts );
+  Display * dpy = xcalib_display_x11( display );
+  int i, n = dpy ? ScreenCount( dpy ) : display ? 1 : 0;
 
-  int size = 0, i,n = 0;
-  char * result = oyjlReadCommandF( &size, "r", malloc, "xrandr | grep Screen" );
-  char ** list = oyjlStringSplit2( result, "\n", NULL, &n, NULL,0 );
-
-  if(list)
+  if(n)
   {
     c = calloc(n+1, sizeof(oyjlOptionChoice_s));
     if(c)
     {
       for(i = 0; i < n; ++i)
       {
-        if(!list[i][0]) break;
         c[i].nick = strdup( oyjlTermColorF(oyjlNO_MARK, "%d", i ) );
-        c[i].name = strdup("");
+        c[i].name = strdup( dpy ? oyjlTermColorF(oyjlNO_MARK, "%dx%d", DisplayWidth( dpy, i ), DisplayHeight( dpy, i ) ) : xcalib_display_name( display ) );
         c[i].description = strdup("");
         c[i].help = strdup("");
       }
     }
-    free(list);
   }
+#endif
 
   return c;
 }
 static oyjlOptionChoice_s * listOutput ( oyjlOption_s * o OYJL_UNUSED, int * y OYJL_UNUSED, oyjlOptions_s * opts OYJL_UNUSED )
 {   
   oyjlOptionChoice_s * c = NULL;
+#ifndef _WIN32
+  xcalib_display_t * display = choicesDisplay( opts );
+  xcalib_output_t * outputs = NULL;
+  int i, n = 0, xrr_version = display ? xcalib_xrr_version( display ) : 0;
 
-  int size = 0, i,n = 0;
-  char * result = oyjlReadCommandF( &size, "r", malloc, "xrandr --listactivemonitors | grep x" );
-  char ** list = oyjlStringSplit2( result, "\n", NULL, &n, NULL,0 );
+  if(xrr_version >= 102)
+    n = xcalib_xrr_get_outputs( display, default_screen( display ), xrr_version, &outputs );
 
-  if(list)
+  if(n)
   {
     c = calloc(n+1, sizeof(oyjlOptionChoice_s));
     if(c)
     {
       for(i = 0; i < n; ++i)
       {
-        if(!list[i][0]) break;
         c[i].nick = strdup( oyjlTermColorF(oyjlNO_MARK, "%d", i ) );
-        c[i].name = strdup("");
-        c[i].description = strdup("");
+        c[i].name = strdup( outputs[i].name );
+        c[i].description = strdup( oyjlTermColorF(oyjlNO_MARK, "%d %s", outputs[i].gamma_size, _("Gamma Entries") ) );
         c[i].help = strdup("");
       }
     }
-    free(list);
   }
+  free(outputs);
+#endif
 
   return c;
 }
@@ -743,6 +1699,15 @@ int myMain( int argc, const char ** argv )
   int version = 0;
   const char * render = 0;
   const char * export_var = 0;
+  const char * cache = 0;
+  const char * batch = 0;
+  int timings = 0;
+  int daemon = 0;
+  const char * fleet = 0;
+  int jobs = 0;
+  int all_outputs = 0;
+  double fade = 0;
+  double fps = 60;
 
   /* handle options */
   /* Select a nick from *version*, *manufacturer*, *copyright*, *license*,
@@ -759,8 +1724,13 @@ int myMain( int argc, const char ** argv )
   /* declare the option choices  *   nick,          name,               description,                  help */
   oyjlOptionChoice_s p_choices[] = {{"TEXT",        "TEXT",             NULL,                         NULL},
                                     {"SVG",         "SVG",              NULL,                         NULL},
+                                    {"JSON",        "JSON",             NULL,                         NULL},
+                                    {"BINARY",      "BINARY",           NULL,                         NULL},
                                     {NULL,NULL,NULL,NULL}};
   oyjlOptionChoice_s E_choices[] = {{_("DISPLAY"),  _("Under X11 systems this variable will hold the display name as used for the -d and -s option."),NULL,NULL},
+                                    {_("XCALIB_CACHE"),_("Directory for cached ramps. It is used when the --cache option is not given."),NULL,NULL},
+                                    {_("XCALIB_VIRTUAL_LOG"),_("File, to which a virtual display appends one line per ramp write on close."),NULL,NULL},
+                                    {_("XCALIB_TIMINGS"),_("Print the --timings report; a file name other than 1 or - receives the JSON instead of stderr."),NULL,NULL},
                                     {NULL,NULL,NULL,NULL}};
 
   oyjlOptionChoice_s A_choices[] = {{_("Assign the VCGT curves of a ICC profile to a screen"),_("xcalib ‐d :0 ‐s 0 ‐v profile_with_vcgt_tag.icc"),NULL,NULL},
@@ -776,7 +1746,7 @@ int myMain( int argc, const char ** argv )
         value_type,              values,             variable_type, variable_name, properties */
     {"oiwi", 0,                          "c","clear",         NULL,     _("Clear"),    _("Clear Gamma LUT"),         _("Reset the Video Card Gamma Table (VCGT) to linear values."),NULL,
         oyjlOPTIONTYPE_NONE,     {0},                oyjlINT,       {.i=&clear},   NULL},
-    {"oiwi", OYJL_OPTION_FLAG_EDITABLE,  "d","display",       NULL,     _("Display"),  _("host:dpy"),                NULL, _("STRING"),
+    {"oiwi", OYJL_OPTION_FLAG_EDITABLE,  "d","display",       NULL,     _("Display"),  _("host:dpy"),                _("A display name virtual:SIZE[,SIZE...][@MICROSECONDS] uses a in memory display with one output per gamma size and the given latency per reply instead of X, e.g. -d virtual:256,1024@500 --all-outputs."), _("STRING"),
         oyjlOPTIONTYPE_FUNCTION,   {.getChoices = listDisplay}, oyjlSTRING, {.s=&display},NULL},
     {"oiwi", OYJL_OPTION_FLAG_EDITABLE,  "s","screen",        NULL,     _("Screen"),   _("Screen Number"),           NULL, _("NUMBER"),
         oyjlOPTIONTYPE_FUNCTION,   {.getChoices = listScreen}, oyjlSTRING, {.s=&screen},NULL},
@@ -784,20 +1754,34 @@ int myMain( int argc, const char ** argv )
     {"oiwi", OYJL_OPTION_FLAG_EDITABLE,  "x","controller",    NULL,     _("Controller"),   _("ATI Controller Index"),_("For FGLRX only"), _("NUMBER"),
         oyjlOPTIONTYPE_CHOICE,   {0},                oyjlINT,       {.i=&controller},  NULL},
 #endif
-    {"oiwi", OYJL_OPTION_FLAG_EDITABLE|OYJL_OPTION_FLAG_IMMEDIATE,  "o","output",        NULL,     _("Output"),   _("Output Number"),           _("It appears in the order as listed in xrandr tool."),_("NUMBER"),
+    {"oiwi", OYJL_OPTION_FLAG_EDITABLE|OYJL_OPTION_FLAG_IMMEDIATE,  "o","output",        NULL,     _("Output"),   _("Output Number"),           _("It appears in the order as listed in xrandr tool. A XRandR output name works as well. A comma separated list selects several outputs."),_("NUMBER"),
         oyjlOPTIONTYPE_FUNCTION,   {.getChoices = listOutput}, oyjlSTRING, {.s=&output},NULL},
+    {"oiwi", 0,                          NULL,"all-outputs",  NULL,     _("All Outputs"),_("Calibrate all active Outputs"),_("Compute the ramps for each active output at its own gamma size and upload them over one connection. Outputs with the same gamma size share the ramps."),NULL,
+        oyjlOPTIONTYPE_NONE,     {0},                oyjlINT,       {.i=&all_outputs}, NULL},
     {"oiwi", 0,                          "i","invert",        NULL,     _("Invert"),   _("Invert the LUT"),          NULL, NULL,
         oyjlOPTIONTYPE_NONE,     {0},                oyjlINT,       {.i=&invert},  NULL},
-    {"oiwi", OYJL_OPTION_FLAG_EDITABLE,  "@",NULL,            NULL,     _("ICC Profle"),_("File Name of a ICC Profile"),NULL,_("ICC_FILE_NAME"),
+    {"oiwi", OYJL_OPTION_FLAG_EDITABLE,  "@",NULL,            NULL,     _("ICC Profle"),_("File Name of a ICC Profile"),_("A ramp file is loaded as well: the TEXT, JSON or BINARY output of -p, a 1D .cube LUT or a .raw file with 16-bit little endian red, green and blue planes."),_("ICC_FILE_NAME"),
         oyjlOPTIONTYPE_FUNCTION,   {.getChoices = listInput}, oyjlSTRING, {.s=&icc_file_name},NULL},
     {"oiwi", 0,                          "a","alter",         NULL,     _("Alter"),    _("Alter Table"),             _("Works according to parameters without ICC Profile."),NULL,
         oyjlOPTIONTYPE_NONE,     {0},                oyjlINT,       {.i=&alter},   NULL},
     {"oiwi", 0,                          "n","noaction",      NULL,     _("No Action"), _("Do not alter video-LUTs."),_("Work's best in conjunction with -v!"), NULL,
         oyjlOPTIONTYPE_NONE,     {0},                oyjlINT,       {.i=&noaction},           NULL},
-    {"oiwi", OYJL_OPTION_FLAG_ACCEPT_NO_ARG|OYJL_OPTION_FLAG_IMMEDIATE,"p","printramps", NULL,     _("Print Ramps"), _("Print Values on stdout."),NULL, _("FORMAT"),
+    {"oiwi", OYJL_OPTION_FLAG_ACCEPT_NO_ARG|OYJL_OPTION_FLAG_IMMEDIATE,"p","printramps", NULL,     _("Print Ramps"), _("Print Values on stdout."),_("The TEXT, JSON and BINARY output is accepted back as ICC_FILE_NAME, e.g. for further -g, -b and -k corrections."), _("FORMAT"),
         oyjlOPTIONTYPE_CHOICE,   {.choices.list = (oyjlOptionChoice_s*)oyjlStringAppendN( NULL, (const char*)p_choices, sizeof(p_choices), 0 )},                oyjlSTRING,       {.s=&printramps},        NULL},
     {"oiwi", 0,                          "l","loss",          NULL,     _("Loss"),     _("Print error introduced by applying ramps to stdout."),NULL, NULL,
         oyjlOPTIONTYPE_NONE,     {0},                oyjlINT,       {.i=&loss},        NULL},
+    {"oiwi", OYJL_OPTION_FLAG_EDITABLE,  NULL,"cache",        NULL,     _("Cache"),    _("Cache Directory"),         _("Store the final ramps per profile, ramp size and correction parameters and reuse them on later calls."),_("DIRECTORY"),
+        oyjlOPTIONTYPE_CHOICE,   {0},                oyjlSTRING,    {.s=&cache},   NULL},
+    {"oiwi", OYJL_OPTION_FLAG_EDITABLE,  NULL,"batch",        NULL,     _("Batch"),    _("Load many Assignments"),   _("Read lines of DISPLAY OUTPUT PROFILE [GAMMA [BRIGHTNESS [CONTRAST]]] from a file or from stdin with \"-\". DISPLAY \"-\" uses the -d option. OUTPUT is a number as for -o or a XRandR output name. PROFILE \"-\" resets the output. All lines of one display share one connection."),_("FILE"),
+        oyjlOPTIONTYPE_CHOICE,   {0},                oyjlSTRING,    {.s=&batch},   NULL},
+    {"oiwi", OYJL_OPTION_FLAG_EDITABLE,  NULL,"fleet",        NULL,     _("Fleet"),    _("Calibrate many Displays"), _("Read one DISPLAY per line from a file or from stdin with \"-\" and assign the ICC profile or with -c the linear ramps to all active outputs or to the -o output of each. The connections are opened concurrently and the ramps are computed once per gamma size. Prints the time needed for each display."),_("FILE"),
+        oyjlOPTIONTYPE_CHOICE,   {0},                oyjlSTRING,    {.s=&fleet},   NULL},
+    {"oiwi", 0,                          NULL,"jobs",         NULL,     _("Jobs"),     _("Number of Workers"),       _("Displays handled at the same time with --fleet. 0 takes the number of CPUs."),_("NUMBER"),
+        oyjlOPTIONTYPE_DOUBLE,   {.dbl = {.d = 0, .start = 0, .end = 256, .tick = 1}},oyjlINT,{.i=&jobs},NULL},
+    {"oiwi", 0,                          NULL,"fade",         NULL,     _("Fade"),     _("Transition Time"),         _("Change from the current ramps to the new ones over the given milliseconds instead of at once. Several outputs fade in step. Needs XRandR and can not be combined with --batch or --fleet."),_("MILLISECONDS"),
+        oyjlOPTIONTYPE_DOUBLE,   {.dbl = {.d = 0, .start = 0, .end = 600000, .tick = 100}},oyjlDOUBLE,{.d=&fade},NULL},
+    {"oiwi", 0,                          NULL,"fps",          NULL,     _("Frame Rate"),_("Frames per Second"),      _("Upper limit of gamma updates per second during --fade. Frames the driver can not take in time are dropped."),_("NUMBER"),
+        oyjlOPTIONTYPE_DOUBLE,   {.dbl = {.d = 60, .start = 1, .end = 240, .tick = 1}},oyjlDOUBLE,{.d=&fps},NULL},
     {"oiwi", 0,                          "g","gamma",         NULL,     _("Gamma"),    _("Specify Gamma"),           _("Global gamma correction value (use 2.2 for WinXP Color Control-like behaviour)"), _("NUMBER"),
         oyjlOPTIONTYPE_DOUBLE,   {.dbl = {.d = 1, .start = 0.1, .end = 5, .tick = 0.1}},oyjlDOUBLE,{.d=&gamma_},NULL},
     {"oiwi", 0,                          "b","brightness",    NULL,     _("Brightness"),_("Specify Lightness Percentage"),NULL,_("NUMBER"),
@@ -828,6 +1812,10 @@ int myMain( int argc, const char ** argv )
         oyjlOPTIONTYPE_NONE,     {0},                oyjlNONE,      {0}, NULL },
     {"oiwi", 0,                          "v","verbose",       NULL,     _("Verbose"),  _("Verbose"),                 NULL, NULL,
         oyjlOPTIONTYPE_NONE,     {0},                oyjlINT,       {.i=&verbose}, NULL},
+    {"oiwi", 0,                          NULL,"daemon",       NULL,     _("Daemon"),   _("Keep Outputs Calibrated"), _("Stay running after --batch and reapply the ramps, when a output is plugged in or a mode set resets its gamma. Stop with SIGINT or SIGTERM."), NULL,
+        oyjlOPTIONTYPE_NONE,     {0},                oyjlINT,       {.i=&daemon}, NULL},
+    {"oiwi", 0,                          NULL,"timings",      NULL,     _("Timings"),  _("Print Timings"),           _("Print a JSON report on stderr with time, X requests and round trips of each stage from option parsing over the XRandR probe and profile parsing to the upload. Setting XCALIB_TIMINGS enables it as well; a file name as value writes the report there."), NULL,
+        oyjlOPTIONTYPE_NONE,     {0},                oyjlINT,       {.i=&timings}, NULL},
     {"oiwi", 0,                          "V","version",       NULL,     _("Version"),  _("Version"),                 NULL, NULL,
         oyjlOPTIONTYPE_NONE,     {0},                oyjlINT,       {.i=&version}, NULL},
     {"oiwi", OYJL_OPTION_FLAG_EDITABLE,  NULL,"render",       NULL,     _("Render"),   NULL,                         NULL, _("STRING"),
@@ -846,13 +1834,15 @@ int myMain( int argc, const char ** argv )
   /* declare option groups, for better syntax checking and UI groups */
   oyjlOptionGroup_s groups[] = {
   /* type,   flags, name,               description,                  help,               mandatory,     optional,      detail,        properties */
-    {"oiwg", 0,     NULL,               _("Set basic parameters"),    NULL,               NULL,          NULL,          "d,s,o,a,n,p,l", NULL},
-    {"oiwg", 0,     NULL,               _("Assign"),                  NULL,               "@",           NULL,          "@",           NULL},
-    {"oiwg", 0,     NULL,               _("Clear"),                   NULL,               "c,d,s",       "o,v",         "c",           NULL},
+    {"oiwg", 0,     NULL,               _("Set basic parameters"),    NULL,               NULL,          NULL,          "d,s,o,all-outputs,a,n,p,l,fade,fps,cache,timings", NULL},
+    {"oiwg", 0,     NULL,               _("Assign"),                  NULL,               "@",           "o,all-outputs,fade,fps,cache,timings","@", NULL},
+    {"oiwg", 0,     NULL,               _("Clear"),                   NULL,               "c,d,s",       "o,all-outputs,v","c",         NULL},
     {"oiwg", 0,     NULL,               _("Invert"),                  NULL,               "i,d,s,@|a",   "o,v,n,p,l",   "i",           NULL},
     {"oiwg", 0,     NULL,               _("Overall Appearance"),      NULL,               "g,b,k,d,s,@|a","o,v,n,p,l",  "g,b,k",       NULL},
     {"oiwg", 0,     NULL,               _("Per Channel Appearance"),  NULL,               "R,G,B,d,s,@|a","S,T,H,I,C,D,o,v,n,p,l","R,S,T,G,H,I,B,C,D",NULL},
-    {"oiwg", 0,     NULL,               _("Show"),                    NULL,               "p,d,s",       "o,v",         "p",           NULL},
+    {"oiwg", 0,     NULL,               _("Batch"),                   NULL,               "batch",       "d,g,b,k,i,n,v,cache,daemon","batch,daemon",  NULL},
+    {"oiwg", 0,     NULL,               _("Fleet"),                   NULL,               "fleet,@|c",   "o,g,b,k,i,n,v,cache,jobs","fleet,jobs", NULL},
+    {"oiwg", 0,     NULL,               _("Show"),                    NULL,               "p,d,s",       "o,v,timings", "p",           NULL},
     {"oiwg", 0,     _("Misc"),          _("General options"),         NULL,               "h,V,render",  "v",           "h,render,V,v",NULL},
     {"",0,0,0,0,0,0,0,0}
   };
@@ -912,14 +1902,20 @@ int myMain( int argc, const char ** argv )
   } else if(ui)
   {
     /* ... working code goes here ... */
+  xcalib_state_t xcalib_state = XCALIB_STATE_INIT;
+  xcalib_ramp_t * ramp = NULL;
   u_int16_t *r_ramp = NULL, *g_ramp = NULL, *b_ramp = NULL;
   int i;
   int donothing = noaction;
   int calcloss = loss;
   int correction = 0;
-  u_int16_t tmpRampVal = 0;
-  unsigned int r_res, g_res, b_res;
   in_name = icc_file_name;
+  xcalib_set_message_func( myMessage );
+  if(timings || getenv("XCALIB_TIMINGS"))
+    xcalib_timings.enabled = 1;
+  timing_stage( "options", 0 );
+  if(!cache)
+    cache = getenv("XCALIB_CACHE");
 
 #ifdef FGLRX
   unsigned
@@ -929,13 +1925,13 @@ int myMain( int argc, const char ** argv )
 #ifndef _WIN32
   /* X11 */
   XF86VidModeGamma gamma;
+  xcalib_display_t * xdisplay = NULL;
   Display *dpy = NULL;
   const char * displayname = display;
-  int xoutput = output?atoi(output):0;
   if(!(displayname && displayname[0]))
   {
     displayname = getenv("DISPLAY");
-    if(!(displayname && displayname[0]))
+    if(!(displayname && displayname[0]) && !fleet)
       error ("Could not read \"DISPLAY\" environment variable");
   }
 #ifdef FGLRX
@@ -953,7 +1949,7 @@ int myMain( int argc, const char ** argv )
   HDC hDc = NULL;
 #endif
 
-  xcalib_state.verbose = verbose;
+  xcalib_state.verbose = xcalib_verbose = verbose;
 
   /* begin program part */
 #ifdef _WIN32
@@ -971,29 +1967,7 @@ int myMain( int argc, const char ** argv )
     usage ();
 #endif
 
-    if(gamma_ != 0.0)
-    {
-      xcalib_state.gamma_cor = gamma_;
-      if(xcalib_state.verbose)
-        message ("gamma: %f", xcalib_state.gamma_cor);
-      correction = 1;
-    }
-    /* take additional brightness into account */
-    if (brightness != -1.0) {
-      xcalib_state.redMin = xcalib_state.greenMin = xcalib_state.blueMin = brightness / 100.0;
-      xcalib_state.redMax = xcalib_state.greenMax = xcalib_state.blueMax =
-        (1.0 - xcalib_state.blueMin) * xcalib_state.blueMax + xcalib_state.blueMin;
-      
-      correction = 1;
-    }
-    /* take additional contrast into account */
-    if (contrast != 0.0) {
-      xcalib_state.redMax = xcalib_state.greenMax = xcalib_state.blueMax = contrast / 100.0;
-      xcalib_state.redMax = xcalib_state.greenMax = xcalib_state.blueMax =
-        (1.0 - xcalib_state.blueMin) * xcalib_state.blueMax + xcalib_state.blueMin;
- 
-      correction = 1;
-    }
+    correction = xcalib_set_correction(&xcalib_state, gamma_, brightness, contrast);
     /* additional red calibration */ 
     if (red_gamma != 0.0) {
       double gamma = red_gamma,
@@ -1036,6 +2010,39 @@ int myMain( int argc, const char ** argv )
       correction = 1;
     }
  
+  /* the fleet and batch uploads switch at once */
+  if(fade > 0.0 && (fleet || batch))
+  {
+    error ("--fade works with -o and --all-outputs, not with --%s", fleet ? "fleet" : "batch");
+    error = 1;
+    goto cleanupX;
+  }
+
+  if(fleet)
+  {
+#ifndef _WIN32
+    error = run_fleet(fleet, clear ? NULL : in_name, output, &xcalib_state, cache,
+                      correction, invert, donothing, jobs) ? 1 : 0;
+    timing_stage( "fleet", 0 );
+#else
+    error ("Fleet mode needs XRandR");
+    error = 1;
+#endif
+    goto cleanupX;
+  }
+
+  if(batch)
+  {
+#ifndef _WIN32
+    error = run_batch(batch, display, &xcalib_state, cache, invert, donothing, daemon && !donothing) ? 1 : 0;
+    timing_stage( "batch", 0 );
+#else
+    error ("Batch mode needs XRandR");
+    error = 1;
+#endif
+    goto cleanupX;
+  }
+
 #ifdef _WIN32
   if ((!clear || !alter) && (!in_name || in_name[0] == '\0')) {
     hDc = FindMonitor(atoi(screen));
@@ -1057,48 +2064,82 @@ int myMain( int argc, const char ** argv )
 #ifndef _WIN32
   /* X11 initializing */
   int scr = 0;
-  if ((dpy = XOpenDisplay (displayname)) == NULL) {
+  snprintf( xcalib_timings.display, sizeof(xcalib_timings.display), "%s", displayname ? displayname : "" );
+  xdisplay = xcalib_display_open (displayname);
+  dpy = xcalib_display_x11 (xdisplay);
+  timing_stage( "open_display", TIMING_SEQ(xdisplay) );
+  if (xdisplay == NULL) {
     if(!donothing)
       error ("Can't open display \"%s\"", displayname);
     else
       warning("Can't open display \"%s\"", displayname);
     return 1;
   }
-  else if (!screen)
-    scr = DefaultScreen (dpy);
+#ifdef FGLRX
+  /* the FGLRX calls need a X connection */
+  if (dpy == NULL) {
+    error ("FGLRX needs a X display, not \"%s\"", displayname);
+    xcalib_display_close (xdisplay);
+    return 1;
+  }
+#endif
+  if (!screen)
+    scr = default_screen (xdisplay);
+  else
+    scr = atoi (screen);
+  /* a display without X connection has one screen only */
+  if (scr < 0 || scr >= (dpy ? ScreenCount (dpy) : 1)) {
+    error ("No screen %d on display \"%s\"", scr, xcalib_display_name (xdisplay));
+    xcalib_display_close (xdisplay);
+    return 1;
+  }
 
   int xrr_version = -1;
   int crtc = 0;
-  int major_versionp = 0;
-  int minor_versionp = 0;
   int n = 0;
-  Window root = RootWindow(dpy, scr);
 
-  XRRQueryVersion( dpy, &major_versionp, &minor_versionp );
-  xrr_version = major_versionp*100 + minor_versionp;
+  xrr_version = xcalib_xrr_version( xdisplay );
+  xcalib_timings.xrr_version = xrr_version;
 
   if(xrr_version >= 102)
   {                           
-    XRRScreenResources * res = XRRGetScreenResources( dpy, root );
-    int ncrtc = 0;
+    xcalib_output_t * outputs = NULL, * out;
 
-    n = res->noutput;
-    for( i = 0; i < n; ++i )
+    n = xcalib_xrr_get_outputs( xdisplay, scr, xrr_version, &outputs );
+    xcalib_timings.outputs = n;
+    timing_stage( "xrr_probe", TIMING_SEQ(xdisplay) );
+
+    /* several outputs */
+    if(all_outputs || (output && strchr(output, ',')))
     {
-      RROutput output = res->outputs[i];
-      XRROutputInfo * output_info = XRRGetOutputInfo( dpy, res,
-                                                        output);
-      if(output_info->crtc)
-        if(ncrtc++ == xoutput)
-        {
-          crtc = output_info->crtc;
-          ramp_size = XRRGetCrtcGammaSize( dpy, crtc );
-          message ("XRandR output:      \t%s", output_info->name);
-        }
+      xcalib_ramp_table_t table;
+      memset( &table, 0, sizeof(table) );
+      table.profile = clear ? NULL : in_name;
+      table.state = &xcalib_state;
+      table.cache_dir = cache;
+      table.correction = correction;
+      table.invert = invert;
+      if(!clear && !(in_name && in_name[0]))
+      {
+        error ("Several outputs need a ICC profile or -c");
+        error = 1;
+      } else
+        error = apply_outputs( xdisplay, outputs, n, all_outputs ? NULL : output, &table, donothing,
+                               fade, fps ) ? 1 : 0;
+      timing_stage( "apply_outputs", TIMING_SEQ(xdisplay) );
+      ramp_table_release( &table );
+      free( outputs );
+      goto cleanupX;
+    }
 
-      XRRFreeOutputInfo( output_info ); output_info = 0;
+    out = xcalib_xrr_find_output( outputs, n, output );
+    if(out)
+    {
+      crtc = out->crtc;
+      ramp_size = out->gamma_size;
+      message ("XRandR output:      \t%s", out->name);
     }
-    //XRRFreeScreenResources(res); res = 0;
+    free( outputs );
   }
 
   /* clean gamma table if option set */
@@ -1109,15 +2150,14 @@ int myMain( int argc, const char ** argv )
 #ifndef FGLRX
     if(xrr_version >= 102)
     {
-      XRRCrtcGamma * gamma = XRRAllocGamma (ramp_size);
-      if(!gamma)
+      ramp = xcalib_ramp_new (ramp_size);
+      if(!ramp)
         warning ("Unable to clear screen gamma. %s", output);
       else
       {
-        for(i=0; i < ramp_size; ++i)
-          gamma->red[i] = gamma->green[i] = gamma->blue[i] = i * 65535 / ramp_size;
-        XRRSetCrtcGamma (dpy, crtc, gamma);
-        XRRFreeGamma (gamma);
+        linear_ramp (ramp);
+        xcalib_xrr_set (xdisplay, crtc, ramp);
+        xcalib_ramp_release (&ramp);
       }
     } else
     if (!XF86VidModeSetGamma (dpy, scr, &gamma))
@@ -1130,9 +2170,12 @@ int myMain( int argc, const char ** argv )
     }
     if (!FGLRX_X11SetGammaRamp_C16native_1024(dpy, scr, controller, 256, &fglrx_gammaramps)) {
 #endif
-      XCloseDisplay (dpy);
+      xcalib_display_close (xdisplay);
+      xdisplay = NULL;
+      dpy = NULL;
       error ("Unable to reset display gamma");
     }
+    timing_stage( "clear", TIMING_SEQ(xdisplay) );
     goto cleanupX;
   }
   
@@ -1144,7 +2187,7 @@ int myMain( int argc, const char ** argv )
 #else
     if (!FGLRX_X11GetGammaRampSize(dpy, scr, &ramp_size)) {
 #endif
-      XCloseDisplay (dpy);
+      xcalib_display_close (xdisplay);
       if(!donothing)
         error ("Unable to query gamma ramp size");
       else {
@@ -1166,57 +2209,38 @@ int myMain( int argc, const char ** argv )
 #endif
 
   /* check for ramp size being a power of 2 and inside the supported range */
-  switch(ramp_size)
+  if(!xcalib_ramp_size_supported(ramp_size))
+    error("unsupported ramp size %u", ramp_size);
+  
+  ramp = xcalib_ramp_new(ramp_size);
+  if(!ramp)
   {
-    case 16:
-    case 32:
-    case 64:
-    case 128:
-    case 256:
-    case 512:
-    case 1024:
-    case 2048:
-    case 4096:
-    case 8192:
-    case 16384:
-    case 32768:
-    case 65536:
-      break;
-    default:
-      error("unsupported ramp size %u", ramp_size);
+    error ("Unable to allocate gamma ramps of size %d", ramp_size);
+    error = 1;
+    goto cleanupX;
   }
-  
-  r_ramp = (unsigned short *) malloc (ramp_size * sizeof (unsigned short));
-  g_ramp = (unsigned short *) malloc (ramp_size * sizeof (unsigned short));
-  b_ramp = (unsigned short *) malloc (ramp_size * sizeof (unsigned short));
+  r_ramp = ramp->red;
+  g_ramp = ramp->green;
+  b_ramp = ramp->blue;
 
   int has_name = in_name && in_name[0] != '\000';
   int print_only = printramps && !has_name;
   if(!alter && !print_only)
   {
-    if( (i = read_vcgt_internal(in_name, r_ramp, g_ramp, b_ramp, ramp_size)) <= 0) {
+    if( (i = xcalib_ramp_load(ramp, in_name, cache, correction, invert, &xcalib_state)) <= 0) {
       if(i<0)
         warning ("Unable to read file \"%s\"", in_name?in_name:"----");
       if(i == 0)
         warning ("No calibration data in ICC profile '%s' found", in_name);
-      free(r_ramp);
-      free(g_ramp);
-      free(b_ramp);
+      xcalib_ramp_release(&ramp);
       return 0;
     }
   } else {
 #ifndef _WIN32
     if (xrr_version >= 102)
     {
-      XRRCrtcGamma * gamma = 0;
-      if((gamma = XRRGetCrtcGamma(dpy, crtc)) == 0 )
+      if(xcalib_xrr_get(xdisplay, crtc, ramp))
         warning ("XRRGetCrtcGamma() is unable to get display calibration", output );
-
-      for (i = 0; i < ramp_size; i++) {
-        r_ramp[i] = gamma->red[i];
-        g_ramp[i] = gamma->green[i];
-        b_ramp[i] = gamma->blue[i];
-      }
     }
     else if (!XF86VidModeGetGammaRamp (dpy, scr, ramp_size, r_ramp, g_ramp, b_ramp))
       warning ("XF86VidModeGetGammaRamp() is unable to get display calibration", output);
@@ -1230,122 +2254,19 @@ int myMain( int argc, const char ** argv )
       b_ramp[i] = winGammaRamp.Blue[i];
     }
 #endif
+    xcalib_ramp_print_info(ramp, &xcalib_state);
+    if(correction != 0)
+      xcalib_ramp_correct(ramp, &xcalib_state);
+    xcalib_ramp_invert(ramp, invert);
   }
+  timing_stage( "parse", TIMING_SEQ(xdisplay) );
 
-  {
-    float redBrightness = 0.0;
-    float redContrast = 100.0;
-    float redMin = 0.0;
-    float redMax = 1.0;
-
-    redMin = (double)r_ramp[0] / 65535.0;
-    redMax = (double)r_ramp[ramp_size - 1] / 65535.0;
-    redBrightness = redMin * 100.0;
-    redContrast = (redMax - redMin) / (1.0 - redMin) * 100.0; 
-    message("Red Brightness: %f   Contrast: %f  Max: %f  Min: %f", redBrightness, redContrast, redMax, redMin);
-  }
-
-  {
-    float greenBrightness = 0.0;
-    float greenContrast = 100.0;
-    float greenMin = 0.0;
-    float greenMax = 1.0;
-
-    greenMin = (double)g_ramp[0] / 65535.0;
-    greenMax = (double)g_ramp[ramp_size - 1] / 65535.0;
-    greenBrightness = greenMin * 100.0;
-    greenContrast = (greenMax - greenMin) / (1.0 - greenMin) * 100.0; 
-    message("Green Brightness: %f   Contrast: %f  Max: %f  Min: %f", greenBrightness, greenContrast, greenMax, greenMin);
-  }
-
-  {
-    float blueBrightness = 0.0;
-    float blueContrast = 100.0;
-    float blueMin = 0.0;
-    float blueMax = 1.0;
-
-    blueMin = (double)b_ramp[0] / 65535.0;
-    blueMax = (double)b_ramp[ramp_size - 1] / 65535.0;
-    blueBrightness = blueMin * 100.0;
-    blueContrast = (blueMax - blueMin) / (1.0 - blueMin) * 100.0; 
-    message("Blue Brightness: %f   Contrast: %f  Max: %f  Min: %f", blueBrightness, blueContrast, blueMax, blueMin);
-  }
-
-  if(correction != 0)
-  {
-    for(i=0; i<ramp_size; i++)
-    {
-      r_ramp[i] =  65536.0 * (((double) pow (((double) r_ramp[i]/65536.0),
-                                xcalib_state.redGamma * (double) xcalib_state.gamma_cor
-                  ) * (xcalib_state.redMax - xcalib_state.redMin)) + xcalib_state.redMin);
-      g_ramp[i] =  65536.0 * (((double) pow (((double) g_ramp[i]/65536.0),
-                                xcalib_state.greenGamma * (double) xcalib_state.gamma_cor
-                  ) * (xcalib_state.greenMax - xcalib_state.greenMin)) + xcalib_state.greenMin);
-      b_ramp[i] =  65536.0 * (((double) pow (((double) b_ramp[i]/65536.0),
-                                xcalib_state.blueGamma * (double) xcalib_state.gamma_cor
-                  ) * (xcalib_state.blueMax - xcalib_state.blueMin)) + xcalib_state.blueMin); 
-    }
-    message("Altering Red LUTs with   Gamma %f   Min %f   Max %f",
-       xcalib_state.redGamma, xcalib_state.redMin, xcalib_state.redMax);
-    message("Altering Green LUTs with   Gamma %f   Min %f   Max %f",
-       xcalib_state.greenGamma, xcalib_state.greenMin, xcalib_state.greenMax);
-    message("Altering Blue LUTs with   Gamma %f   Min %f   Max %f",
-       xcalib_state.blueGamma, xcalib_state.blueMin, xcalib_state.blueMax);
-  }
-
-  if(!invert) {
-    /* ramps should be increasing - otherwise content is nonsense! */
-    for (i = 0; i < ramp_size - 1; i++) {
-      if (r_ramp[i + 1] < r_ramp[i])
-        warning ("red gamma table not increasing [%d]%d %d", i, r_ramp[i], r_ramp[i + 1]);
-      if (g_ramp[i + 1] < g_ramp[i])
-        warning ("green gamma table not increasing [%d]%d %d", i, r_ramp[i], r_ramp[i + 1]);
-      if (b_ramp[i + 1] < b_ramp[i])
-        warning ("blue gamma table not increasing [%d]%d %d", i, r_ramp[i], r_ramp[i + 1]);
-    }
-  } else {
-    for (i = 0; i < ramp_size; i++) {
-      if(i >= ramp_size / 2)
-        break;
-      tmpRampVal = r_ramp[i];
-      r_ramp[i] = r_ramp[ramp_size - i - 1];
-      r_ramp[ramp_size - i - 1] = tmpRampVal;
-      tmpRampVal = g_ramp[i];
-      g_ramp[i] = g_ramp[ramp_size - i - 1];
-      g_ramp[ramp_size - i - 1] = tmpRampVal;
-      tmpRampVal = b_ramp[i];
-      b_ramp[i] = b_ramp[ramp_size - i - 1];
-      b_ramp[ramp_size - i - 1] = tmpRampVal;
-    }
-  }
   if(calcloss) {
     char * tr = NULL, * tg = NULL, * tb = NULL;
+    unsigned int lost[3];
     fprintf(stdout, "Resolution loss for %d entries:\n", ramp_size);
-    r_res = 0;
-    g_res = 0;
-    b_res = 0;
-    tmpRampVal = 0xffff;
-    for(i = 0; i < ramp_size; i++) {
-      if ((r_ramp[i] & 0xff00) != (tmpRampVal & 0xff00)) {
-        r_res++;
-      }
-      tmpRampVal = r_ramp[i];
-    }
-    tmpRampVal = 0xffff;
-    for(i = 0; i < ramp_size; i++) {
-      if ((g_ramp[i] & 0xff00) != (tmpRampVal & 0xff00)) {
-        g_res++;
-      }
-      tmpRampVal = g_ramp[i];
-    }
-    tmpRampVal = 0xffff;
-    for(i = 0; i < ramp_size; i++) {
-      if ((b_ramp[i] & 0xff00) != (tmpRampVal & 0xff00)) {
-        b_res++;
-      }
-      tmpRampVal = b_ramp[i];
-    }
-    myMessage( oyjlMSG_INFO, 0, OYJL_DBG_FORMAT "%s %d  %s %d  %s %d  colors lost", OYJL_DBG_ARGS, oyjlTermColorPtr(oyjlRED, &tr, "R:"), ramp_size - r_res, oyjlTermColorPtr(oyjlGREEN, &tg, "G:"), ramp_size - g_res, oyjlTermColorPtr(oyjlBLUE, &tb, "B:"), ramp_size - b_res );
+    xcalib_ramp_loss(ramp, lost);
+    myMessage( oyjlMSG_INFO, 0, OYJL_DBG_FORMAT "%s %d  %s %d  %s %d  colors lost", OYJL_DBG_ARGS, oyjlTermColorPtr(oyjlRED, &tr, "R:"), lost[0], oyjlTermColorPtr(oyjlGREEN, &tg, "G:"), lost[1], oyjlTermColorPtr(oyjlBLUE, &tb, "B:"), lost[2] );
     free(tr); free(tg); free(tb);
   }
 #ifdef _WIN32
@@ -1359,49 +2280,15 @@ int myMain( int argc, const char ** argv )
  
   if(printramps)
   {
-    if(strcasecmp(printramps, "svg") == 0)
-    {
-#ifdef OYJL_HAVE_LOCALE_H
-      char * save_locale = oyjlStringCopy( setlocale(LC_NUMERIC, 0 ), malloc );
-      setlocale(LC_NUMERIC, "C");
-#endif
-      char * svg = oyjlStringCopy("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n",0);
-      /* header */
-      oyjlStringAdd( &svg, 0,0, "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" width=\"1024\" height=\"1024\" viewBox=\"0 0 1024 1024\">\n");
-      /* background rectangle */
-      oyjlStringAdd( &svg, 0,0, "<rect x=\"-102.4\" y=\"-102.4\" width=\"1228.8\" height=\"1228.8\" fill=\"rgb(67.08324%, 67.07561%, 67.084765%)\" fill-opacity=\"0.5\"/>\n");
-      /* add frame */
-      oyjlStringAdd( &svg, 0,0, "<path fill=\"none\" stroke-width=\"5.6\" stroke=\"rgb(0%, 0%, 0%)\" d=\"M 25.398438 25.398438 L 998.199219 25.398438 L 998.199219 998.199219 L 25.398438 998.199219 Z M 25.398438 25.398438 \"/>\n");
-      /* red curve */
-      oyjlStringAdd( &svg, 0,0, "<path fill=\"none\" stroke-width=\"4\" stroke-linecap=\"butt\" stroke-linejoin=\"miter\" stroke=\"rgb(100%, 0%, 0%)\" d=\"");
-      for(i=0; i<ramp_size; i++)
-        oyjlStringAdd( &svg, 0,0, "%s %g %g ", i==0?"M":"L", 51.5 + (973.5-51.5) / ramp_size * i, 973.5 - r_ramp[i]/65535.0 * (973.5-51.5) );
-      oyjlStringAdd( &svg, 0,0, " \"/>\n" );
-      /* green curve */
-      oyjlStringAdd( &svg, 0,0, "<path fill=\"none\" stroke-width=\"4\" stroke-linecap=\"butt\" stroke-linejoin=\"miter\" stroke=\"rgb(0%, 100%, 0%)\" d=\"");
-      for(i=0; i<ramp_size; i++)
-        oyjlStringAdd( &svg, 0,0, "%s %g %g ", i==0?"M":"L", 51.5 + (973.5-51.5) / ramp_size * i, 973.5 - g_ramp[i]/65535.0 * (973.5-51.5) );
-      oyjlStringAdd( &svg, 0,0, " \"/>\n" );
-      /* blue curve */
-      oyjlStringAdd( &svg, 0,0, "<path fill=\"none\" stroke-width=\"4\" stroke-linecap=\"butt\" stroke-linejoin=\"miter\" stroke=\"rgb(0%, 0%, 100%)\" d=\"");
-      for(i=0; i<ramp_size; i++)
-        oyjlStringAdd( &svg, 0,0, "%s %g %g ", i==0?"M":"L", 51.5 + (973.5-51.5) / ramp_size * i, 973.5 - b_ramp[i]/65535.0 * (973.5-51.5) );
-      oyjlStringAdd( &svg, 0,0, " \"/>\n" );
-      /* close */
-      oyjlStringAdd( &svg, 0,0, "</svg>\n" );
-#ifdef OYJL_HAVE_LOCALE_H
-      setlocale(LC_NUMERIC, save_locale);
-      if(save_locale) free( save_locale );
-#endif
-      fputs( svg, stdout );
-      free(svg);
-    }
-    else
-    {
-      for(i=0; i<ramp_size; i++)
-        fprintf(stdout,"%d %d %d\n", r_ramp[i], g_ramp[i], b_ramp[i]);
-    }
+    const char * format = printramps;
+    /* -p without a known format prints TEXT */
+    if(strcasecmp(format, "SVG") && strcasecmp(format, "JSON") && strcasecmp(format, "BINARY"))
+      format = "TEXT";
+    if(xcalib_ramp_print(ramp, format, stdout) < 0)
+      warning ("Unable to print ramps: %s", printramps);
   }
+  if(calcloss || printramps)
+    timing_stage( "print", TIMING_SEQ(xdisplay) );
 
   if(!donothing) {
     /* write gamma ramp to X-server */
@@ -1416,19 +2303,21 @@ int myMain( int argc, const char ** argv )
 # else
     if(xrr_version >= 102)
     {
-      XRRCrtcGamma * gamma = XRRAllocGamma (ramp_size);
-      if(!gamma)
-        warning ("Unable to calibrate display", output);
-      else
+      if(fade > 0.0)
       {
-        for(i=0; i < ramp_size; ++i)
-        {
-          gamma->red[i] = r_ramp[i];
-          gamma->green[i] = g_ramp[i];
-          gamma->blue[i] = b_ramp[i];
-        }
-        XRRSetCrtcGamma (dpy, crtc, gamma);
-        XRRFreeGamma (gamma);
+        double start = xcalib_time_ms();
+        i = xcalib_xrr_fade(xdisplay, crtc, ramp, fade, fps);
+        if(i < 0)
+          warning ("Unable to calibrate display", output);
+        else
+          message ("X-LUT faded in %d frames in %.0f ms", i, xcalib_time_ms() - start);
+      } else
+      {
+        i = xcalib_xrr_apply(xdisplay, crtc, ramp);
+        if(i < 0)
+          warning ("Unable to calibrate display", output);
+        else
+          message ("X-LUT %s", i ? "unchanged, nothing written" : "written");
       }
     } else
     if (!XF86VidModeSetGammaRamp (dpy, scr, ramp_size, r_ramp, g_ramp, b_ramp))
@@ -1437,19 +2326,21 @@ int myMain( int argc, const char ** argv )
     if (!SetDeviceGammaRamp(hDc, &winGammaRamp))
 #endif
       warning ("Unable to calibrate display", output);
+    timing_stage( "upload", TIMING_SEQ(xdisplay) );
   }
 
   message ("X-LUT size:      \t%d", ramp_size);
 
-  free(r_ramp);
-  free(g_ramp);
-  free(b_ramp);
+  xcalib_ramp_release(&ramp);
 
 cleanupX:
 #ifndef _WIN32
-  if(dpy)
+  if(xdisplay)
     if(!donothing)
-      XCloseDisplay (dpy);
+    {
+      xcalib_display_close (xdisplay);
+      timing_stage( "close_display", 0 );
+    }
 #endif
 
   }
@@ -1466,6 +2357,13 @@ cleanupX:
     }
   }
   oyjlUi_Release( &ui );
+#ifndef _WIN32
+  if(choices_display)
+  {
+    xcalib_display_close( choices_display );
+    choices_display = NULL;
+  }
+#endif
 
   return error;
 }
@@ -1476,10 +2374,14 @@ int main( int argc_, char**argv_, char ** envv )
 {
   int argc = argc_;
   char ** argv = argv_;
+#ifdef INCLUDE_OYJL_C
   oyjlTranslation_s * trc_ = NULL;
+#endif
   const char * loc = NULL;
   const char * lang;
 
+  xcalib_timings.start = xcalib_timings.last = xcalib_time_ms();
+
 #ifdef __ANDROID__
   argv = calloc( argc + 2, sizeof(char*) );
   memcpy( argv, argv_, (argc + 2) * sizeof(char*) );
@@ -1489,10 +2391,10 @@ int main( int argc_, char**argv_, char ** envv )
   environment = envv;
 #endif
 
-  /* language needs to be initialised before setup of data structures */
-  int use_gettext = 0;
+  /* language needs to be initialised before setup of data structures;
+   * the translations load on the first lookup, see xcalib_translation() */
 #ifdef OYJL_HAVE_LIBINTL_H
-  use_gettext = 1;
+  xcalib_use_gettext = 1;
 #endif
 #ifdef OYJL_HAVE_LOCALE_H
   loc = oyjlSetLocale(LC_ALL,"");
@@ -1507,6 +2409,10 @@ int main( int argc_, char**argv_, char ** envv )
   if(lang)
     loc = lang;
 
+  xcalib_loc = loc;
+#ifdef INCLUDE_OYJL_C
+  /* _() does no lookup here; the domain is set up as before for Oyjl */
+  xcalib_translation_ms = xcalib_time_ms();
   if(loc)
   {
     const char * my_domain = MY_DOMAIN;
@@ -1517,14 +2423,22 @@ int main( int argc_, char**argv_, char ** envv )
       my_domain = NULL;
     trc = trc_ = oyjlTranslation_New( loc, my_domain, &static_catalog, 0,0,0,0 );
   }
-  oyjlInitLanguageDebug( "xcalib", NULL, NULL, use_gettext, NULL, NULL, &trc_, NULL );
+  oyjlInitLanguageDebug( "xcalib", NULL, NULL, xcalib_use_gettext, NULL, NULL, &trc_, NULL );
   if(MY_DOMAIN && strcmp(MY_DOMAIN,"oyjl") == 0)
     trc = oyjlTranslation_Get( MY_DOMAIN );
+  xcalib_translation_ms = xcalib_time_ms() - xcalib_translation_ms;
+#endif
+  timing_stage( "locale", 0 );
 
   myMain(argc, (const char **)argv);
 
+#ifdef INCLUDE_OYJL_C
   oyjlTranslation_Release( &trc_ );
+#endif
   oyjlLibRelease();
+  timing_stage( "release", 0 );
+  if(xcalib_timings.enabled)
+    timing_report();
 
 #ifdef __ANDROID__
   free( argv );
@@ -0,0 +1,260 @@
+/*
+ * xcalib - download vcgt gamma tables to your X11 video card
+ *
+ * (c) 2004-2005 Stefan Doehla <stefan AT doehla DOT de>
+ *
+ * This program is GPL-ed postcardware! please see README
+ *
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA.
+ */
+
+/*
+ * libxcalib - the calibration core of xcalib
+ *
+ * A calibration runs in three stages, each one a call:
+ * - parse:     xcalib_ramp_from_profile() fills a ramp from a ICC profile
+ * - transform: xcalib_ramp_correct() and xcalib_ramp_invert() apply the
+ *              gamma, brightness and contrast of a xcalib_state_t
+ * - apply:     xcalib_xrr_apply() uploads a ramp to a XRandR CRTC
+ * xcalib_ramp_load() runs parse and transform and uses the ramp cache.
+ * The caller owns the state, the ramps and the display connection.
+ *
+ * The library keeps no per calibration data outside of the state and
+ * the ramps passed in, so parse and transform calls with their own
+ * state and ramps can run concurrently, also on a shared cache
+ * directory. The message hook is process wide; set it before starting
+ * threads. The apply stage uses Xlib and needs one xcalib_display_t per
+ * thread or XInitThreads().
+ */
+
+/* vim: set ai ts=2 sw=2 expandtab: */
+
+#ifndef XCALIB_H
+#define XCALIB_H
+
+#include <stdio.h>
+
+#ifndef _WIN32
+# include <X11/Xlib.h>
+# include <X11/extensions/Xrandr.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* correction parameters and verbosity of one calibration */
+typedef struct xcalib_state_t {
+  unsigned int verbose;
+  float redGamma;
+  float redMin;
+  float redMax;
+  float greenGamma;
+  float greenMin;
+  float greenMax;
+  float blueGamma;
+  float blueMin;
+  float blueMax;
+  float gamma_cor;
+} xcalib_state_t;
+
+/* initialiser for a neutral xcalib_state_t */
+#define XCALIB_STATE_INIT {0, 1.0, 0.0, 1.0, 1.0, 0.0, 1.0, 1.0, 0.0, 1.0, 1.0}
+
+/* three channel gamma ramp with 16-bit entries */
+typedef struct {
+  unsigned int size;
+  unsigned short * red;
+  unsigned short * green;
+  unsigned short * blue;
+} xcalib_ramp_t;
+
+/* message codes; they match oyjlMSG_e */
+#define XCALIB_MSG_INFO    400
+#define XCALIB_MSG_WARNING 401
+#define XCALIB_MSG_ERROR   403
+
+/* message hook; context is the state of the call or NULL, which lets
+ * a hook route messages of concurrent calibrations; it must be thread
+ * safe when the library is used from several threads */
+typedef int (*xcalib_message_f)      ( int                 code,
+                                       const void        * context,
+                                       const char        * format,
+                                       ... );
+void           xcalib_set_message_func(xcalib_message_f    func );
+
+xcalib_ramp_t * xcalib_ramp_new      ( unsigned int        size );
+void           xcalib_ramp_release   ( xcalib_ramp_t    ** ramp );
+int            xcalib_ramp_size_supported(unsigned int     size );
+int            xcalib_ramp_resample  ( const xcalib_ramp_t * src,
+                                       xcalib_ramp_t     * dst );
+
+/* parse; also reads the TEXT, JSON and BINARY output of
+ * xcalib_ramp_print(), 1D .cube files and .raw files holding the BINARY
+ * planes without header */
+int            xcalib_ramp_from_profile(xcalib_ramp_t    * ramp,
+                                       const char        * filename,
+                                       const xcalib_state_t * state );
+/* transform */
+int            xcalib_set_correction ( xcalib_state_t    * state,
+                                       double              gamma_,
+                                       double              brightness,
+                                       double              contrast );
+void           xcalib_ramp_print_info( const xcalib_ramp_t * ramp,
+                                       const xcalib_state_t * state );
+void           xcalib_ramp_correct   ( xcalib_ramp_t     * ramp,
+                                       const xcalib_state_t * state );
+void           xcalib_ramp_invert    ( xcalib_ramp_t     * ramp,
+                                       int                 invert );
+/* blend from and to of equal size; t = 0 gives from, t = 1 gives to */
+int            xcalib_ramp_mix       ( const xcalib_ramp_t * from,
+                                       const xcalib_ramp_t * to,
+                                       double              t,
+                                       xcalib_ramp_t     * out );
+/* entries per channel which give no new 8-bit value */
+void           xcalib_ramp_loss      ( const xcalib_ramp_t * ramp,
+                                       unsigned int        lost[3] );
+/* parse and transform with the ramp cache in cache_dir */
+int            xcalib_ramp_load      ( xcalib_ramp_t     * ramp,
+                                       const char        * filename,
+                                       const char        * cache_dir,
+                                       int                 correction,
+                                       int                 invert,
+                                       const xcalib_state_t * state );
+
+/* BINARY ramp files start with a 16 byte header: the magic, version 1,
+ * 3 channels, 16 bits, one zero byte, the entry count as 32-bit little
+ * endian and 4 zero bytes; the red, green and blue planes follow as
+ * 16-bit little endian values */
+#define XCALIB_RAMP_MAGIC "XCLR"
+
+/* export as "TEXT", "SVG", "JSON" or "BINARY" */
+int            xcalib_ramp_print     ( const xcalib_ramp_t * ramp,
+                                       const char        * format,
+                                       FILE              * fp );
+
+double         xcalib_time_ms        ( void );
+
+#ifndef _WIN32
+/* active XRandR output */
+typedef struct {
+  RROutput output;
+  RRCrtc crtc;
+  int gamma_size;
+  char name[64];
+} xcalib_output_t;
+
+/* a write to a virtual CRTC; ms counts from opening the display and
+ * hash is the FNV-1a of the red, green and blue planes */
+typedef struct {
+  RRCrtc crtc;
+  unsigned int size;
+  double ms;
+  unsigned long long hash;
+} xcalib_virtual_write_t;
+
+/* a display for the xcalib_xrr_* calls: a X connection, a in memory
+ * display or a backend of the caller */
+typedef struct xcalib_display_s xcalib_display_t;
+
+/* the calls behind the xcalib_xrr_* functions; data is the pointer
+ * given to xcalib_display_new(), close frees it and may be NULL */
+typedef struct {
+  int (*version)                     ( void              * data );
+  int (*get_outputs)                 ( void              * data,
+                                       int                 screen,
+                                       int                 xrr_version,
+                                       xcalib_output_t  ** outputs );
+  int (*ramp_equal)                  ( void              * data,
+                                       RRCrtc              crtc,
+                                       const xcalib_ramp_t * ramp );
+  int (*get)                         ( void              * data,
+                                       RRCrtc              crtc,
+                                       xcalib_ramp_t     * ramp );
+  int (*set)                         ( void              * data,
+                                       RRCrtc              crtc,
+                                       const xcalib_ramp_t * ramp );
+  void (*sync)                       ( void              * data );
+  void (*close)                      ( void              * data );
+} xcalib_backend_t;
+
+/* "virtual:SIZE[,SIZE...][@MICROSECONDS]" opens a display in memory
+ * with one output per gamma size, named VIRTUAL-0 ..., which waits the
+ * given latency for each reply; the xcalib_xrr_* calls work on it
+ * without X. Other names go to XOpenDisplay().
+ * xcalib_display_x11() gives the X connection for other Xlib calls;
+ * it is NULL for virtual displays and those of xcalib_display_new(),
+ * which have one screen. The backend must live until close. */
+xcalib_display_t * xcalib_display_open( const char        * name );
+xcalib_display_t * xcalib_display_new( const char        * name,
+                                       const xcalib_backend_t * backend,
+                                       void              * data );
+void           xcalib_display_close  ( xcalib_display_t  * display );
+Display *      xcalib_display_x11    ( xcalib_display_t  * display );
+const char *   xcalib_display_name   ( xcalib_display_t  * display );
+int            xcalib_display_is_virtual(xcalib_display_t * display );
+/* the X sequence number of the last request or, without X, the
+ * number of backend calls */
+unsigned long  xcalib_display_requests(xcalib_display_t  * display );
+int            xcalib_virtual_writes ( xcalib_display_t  * display,
+                                       const xcalib_virtual_write_t ** writes );
+/* major * 100 + minor, 0 without XRandR */
+int            xcalib_xrr_version    ( xcalib_display_t  * display );
+
+/* built with HAVE_XCB, the queries of all outputs and the gamma
+ * reads go pipelined over the XCB connection of the display */
+int            xcalib_xrr_get_outputs( xcalib_display_t  * display,
+                                       int                 screen,
+                                       int                 xrr_version,
+                                       xcalib_output_t  ** outputs );
+xcalib_output_t * xcalib_xrr_find_output(xcalib_output_t * outputs,
+                                       int                 n,
+                                       const char        * output );
+/* apply */
+int            xcalib_xrr_ramp_equal ( xcalib_display_t  * display,
+                                       RRCrtc              crtc,
+                                       const xcalib_ramp_t * ramp );
+int            xcalib_xrr_apply      ( xcalib_display_t  * display,
+                                       RRCrtc              crtc,
+                                       const xcalib_ramp_t * ramp );
+int            xcalib_xrr_get        ( xcalib_display_t  * display,
+                                       RRCrtc              crtc,
+                                       xcalib_ramp_t     * ramp );
+int            xcalib_xrr_set        ( xcalib_display_t  * display,
+                                       RRCrtc              crtc,
+                                       const xcalib_ramp_t * ramp );
+/* replies the xcalib_xrr_* calls waited for since program start */
+unsigned long  xcalib_xrr_round_trips( void );
+/* paced transition from the current CRTC ramp to the ramp to */
+int            xcalib_xrr_fade       ( xcalib_display_t  * display,
+                                       RRCrtc              crtc,
+                                       const xcalib_ramp_t * to,
+                                       double              duration_ms,
+                                       double              fps );
+/* the same for n CRTCs of one display in step */
+int            xcalib_xrr_fade_crtcs ( xcalib_display_t  * display,
+                                       int                 n,
+                                       const RRCrtc      * crtcs,
+                                       const xcalib_ramp_t * const * to,
+                                       double              duration_ms,
+                                       double              fps );
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* XCALIB_H */
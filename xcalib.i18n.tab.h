@@ -0,0 +1,88 @@
+/* generated from xcalib.i18n.json by cmake/xcalibI18nTable.cmake - do not edit */
+
+static const char * const xcalib_i18n_de[][2] = {
+  {"Alter", "Ändern"},
+  {"Alter Table", "Andere Tabelle"},
+  {"Assign", "Zuweisen"},
+  {"Assign the VCGT curves of a ICC profile to a screen", "Weise die VCGT Kurven aus einem ICC Profil einem Bildschirm zu"},
+  {"Blue Brightness", "Blaue Helligkeit"},
+  {"Blue Contrast", "Blauer Kontrast"},
+  {"Blue Gamma", "Blaues Gamma"},
+  {"Brightness", "Helligkeit"},
+  {"Clear", "Zurücksetzen"},
+  {"Clear Gamma LUT", "Setze Gamma Tabelle zurück"},
+  {"Contrast", "Kontrast"},
+  {"Controller", "Adapter"},
+  {"DISPLAY", "DISPLAY"},
+  {"December 14, 2023", "14. Dezember 2023"},
+  {"Display", "Bildanzeige"},
+  {"Do not alter video-LUTs.", "Belasse die Gamma Tabelle"},
+  {"File Name of a ICC Profile", "Dateiname eines ICC Farbprofiles"},
+  {"For FGLRX only", "Nur für FGLRX"},
+  {"For more information read the man page:", "Für mehr Informationen lesen Sie das Handbuch:"},
+  {"General options", "Allgemeine Optionen"},
+  {"Green Brightness", "Grüne Helligkeit"},
+  {"Green Contrast", "Grüner Kontrast"},
+  {"Green Gamma", "Grünes Gamma"},
+  {"ICC Profle", "ICC Farbprofil"},
+  {"ICC_FILE_NAME", "ICC_DATEI_NAME"},
+  {"Insufficient Data:", "Unzureichende Daten:"},
+  {"Invert", "Umkehren"},
+  {"Invert the LUT", "Kehre die Gamma Tabelle um"},
+  {"It appears in the order as listed in xrandr tool.", "Erscheint in der Reihenfolge wie im xrandr Werkzeug."},
+  {"Loss", "Verlust"},
+  {"Monitor Calibration Loader", "Monitor Kalibrationseinrichter"},
+  {"NUMBER", "NUMMER"},
+  {"No Action", "Kein Eintrag"},
+  {"Output", "Anschluss"},
+  {"Output Number", "Anschluss Nummer"},
+  {"Overall Appearance", "Allgemeine Farbanpassung"},
+  {"Per Channel Appearance", "Farbanpassung pro Farbkanal"},
+  {"Print Ramps", "Zeige Kurven"},
+  {"Print Values on stdout.", "Zeige Werte auf der Standardausgabe stdout"},
+  {"Print error introduced by applying ramps to stdout.", "Zeige Verluste durch die Anwendung der Kurven auf stdout."},
+  {"Program Error:", "Programmfehler:"},
+  {"Red Brightness", "Rote Helligkeit"},
+  {"Red Contrast", "Roter Kontrast"},
+  {"Red Gamma", "Rote Gamma Kurve"},
+  {"Render", "Darstellung"},
+  {"Reset a screens hardware LUT in order to do a calibration", "Setze die Geräte-LUT einer Anzeige für eine Kalibration zurück."},
+  {"Reset the Video Card Gamma Table (VCGT) to linear values.", "Setze die Video Card Gamma Tablle (VCGT) auf lineare Werte."},
+  {"STRING", "TEXT"},
+  {"Screen", "Ausgabe"},
+  {"Screen Number", "Ausgabenummer"},
+  {"Security Alert:", "Sicherheitshinweis:"},
+  {"Set basic parameters", "Grundlegende Einstellungen"},
+  {"Set maximum value relative to brightness.", "Setze den maxmalen Werten im Verhältnis zur Helligkeit."},
+  {"Specify Blue Brightness Percentage", "Setze Blaue Helligkeit in Prozent"},
+  {"Specify Blue Contrast Percentage", "Setze Blauen Kontrast in Prozent"},
+  {"Specify Blue Gamma ", "Setze Blaue Gamma Kurve"},
+  {"Specify Contrast Percentage", "Setze Kontrast in Prozent"},
+  {"Specify Gamma", "Setze Gamma Kurve"},
+  {"Specify Green Brightness Percentage", "Setze Grüne Helligkeit in Prozent"},
+  {"Specify Green Contrast Percentage", "Setze Grünen Kontrast in Prozent"},
+  {"Specify Green Gamma ", "Setze Grüne Gamma Kurve"},
+  {"Specify Lightness Percentage", "Setze Helligkeit in Prozent"},
+  {"Specify Red Brightness Percentage", "Setze Rote Helligkeit in Prozent"},
+  {"Specify Red Contrast Percentage", "Setze Roten Kontrast in Prozent"},
+  {"Specify Red Gamma ", "Setze Rote Gamma Kurve"},
+  {"The tool loads ’vcgt’‐tag of ICC profiles to the server using the XRandR/XVidMode/GDI Extension in order to load calibrate curves to your graphics card.", "Das Werkzeug lädt den vcgt-Tag eines ICC Farbprofils in den Bildserver mit der XRandR/XVidMode/GDI Erweiterung um die Grafikkarte passend zum Monitor farblich zu kalibrieren."},
+  {"Tiny monitor calibration loader for Xorg and Windows.", "Monitor Kalibrationseinrichtung für Xorg und Windows"},
+  {"Under X11 systems this variable will hold the display name as used for the -d and -s option.", "Diese Variable enthält den Ausgabenamen unter X11 Systemen wie für die -d und -s Optionen benutzt."},
+  {"Usage Error:", "Benutzerfehler:"},
+  {"Verbose", "Plaudernd"},
+  {"Version", "Version"},
+  {"Work's best in conjunction with -v!", "Arbeitet am besten zusammen mit der -v Option."},
+  {"Works according to parameters without ICC Profile.", "Arbeitet alternativ zu einem ICC Profil nur mit den Parametern."},
+  {"xcalib ‐d :0 ‐s 0 ‐v profile_with_vcgt_tag.icc", "xcalib ‐d :0 ‐s 0 ‐v profil_mit_vcgt_tag.icc"},
+  {0, 0}
+};
+
+static const struct {
+  const char * lang;
+  const char * const (*table)[2];
+  int size;
+} xcalib_i18n_tables[] = {
+  {"de", xcalib_i18n_de, 74},
+  {0, 0, 0}
+};
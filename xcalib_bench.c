@@ -0,0 +1,323 @@
+/*
+ * xcalib - download vcgt gamma tables to your X11 video card
+ *
+ * (c) 2004-2005 Stefan Doehla <stefan AT doehla DOT de>
+ *
+ * This program is GPL-ed postcardware! please see README
+ *
+ * It is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston,
+ * MA 02111-1307 USA.
+ */
+
+/*
+ * xcalib_bench times the libxcalib stages over the bundled profiles at
+ * every ramp size from 16 to 65536:
+ *   parse    xcalib_ramp_from_profile()
+ *   resample xcalib_ramp_resample() from 256 entries
+ *   correct  xcalib_ramp_correct() with gamma, brightness and contrast
+ *   loss     xcalib_ramp_loss()
+ *   text     xcalib_ramp_print() TEXT
+ *   svg      xcalib_ramp_print() SVG
+ *   apply    one xcalib invocation on a virtual display: open, XRandR
+ *            probe, upload, read back and close; a read back, which
+ *            differs from the uploaded ramp, fails the benchmark
+ * and reports ns per ramp entry and heap allocations per run. Built with
+ * XCALIB_BENCH_WRAP and linked with -Wl,--wrap=malloc,--wrap=calloc,
+ * --wrap=realloc the allocations are counted; otherwise they show as -1.
+ *
+ * usage: xcalib_bench [--json] [--time MILLISECONDS] [PROFILE_DIR]
+ */
+
+/* vim: set ai ts=2 sw=2 expandtab: */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xcalib.h"
+
+#ifndef XCALIB_VERSION
+# define XCALIB_VERSION "unknown"
+#endif
+
+#ifdef _WIN32
+# define NULL_DEVICE "NUL"
+#else
+# define NULL_DEVICE "/dev/null"
+#endif
+
+static const char * bench_profiles[] = {
+  "bluish.icc",
+  "gamma_1_0.icc",
+  "gamma_2_2.icc",
+  "gamma_2_2_bright.icc",
+  "gamma_2_2_lowContrast.icc",
+  "AdobeGammaTest.icm",
+  NULL
+};
+
+static long bench_allocs = -1;
+
+#ifdef XCALIB_BENCH_WRAP
+void * __real_malloc(size_t size);
+void * __real_calloc(size_t n, size_t size);
+void * __real_realloc(void * ptr, size_t size);
+
+void * __wrap_malloc(size_t size)
+{ ++bench_allocs; return __real_malloc(size); }
+void * __wrap_calloc(size_t n, size_t size)
+{ ++bench_allocs; return __real_calloc(n, size); }
+void * __wrap_realloc(void * ptr, size_t size)
+{ ++bench_allocs; return __real_realloc(ptr, size); }
+#endif
+
+/* input of one timed case */
+typedef struct {
+  const char * filename;
+  xcalib_ramp_t * ramp;                /* result of the stage */
+  const xcalib_ramp_t * src;           /* 256 entries from the profile */
+  const xcalib_state_t * state;
+  FILE * null;
+#ifndef _WIN32
+  char display[32];                    /* virtual:SIZE */
+  xcalib_ramp_t * back;                /* read back of apply */
+#endif
+} bench_case_t;
+
+typedef int (*bench_stage_f)         ( bench_case_t      * c );
+
+static int
+stage_parse(bench_case_t * c)
+{
+  return xcalib_ramp_from_profile(c->ramp, c->filename, c->state) > 0 ? 0 : -1;
+}
+
+static int
+stage_resample(bench_case_t * c)
+{
+  return xcalib_ramp_resample(c->src, c->ramp) > 0 ? 0 : -1;
+}
+
+static int
+stage_correct(bench_case_t * c)
+{
+  xcalib_ramp_correct(c->ramp, c->state);
+  return 0;
+}
+
+static int
+stage_loss(bench_case_t * c)
+{
+  unsigned int lost[3];
+  xcalib_ramp_loss(c->ramp, lost);
+  return lost[0] > c->ramp->size ? -1 : 0;
+}
+
+static int
+stage_text(bench_case_t * c)
+{
+  return xcalib_ramp_print(c->ramp, "TEXT", c->null);
+}
+
+static int
+stage_svg(bench_case_t * c)
+{
+  return xcalib_ramp_print(c->ramp, "SVG", c->null);
+}
+
+#ifndef _WIN32
+static int
+stage_apply(bench_case_t * c)
+{
+  xcalib_display_t * display = xcalib_display_open(c->display);
+  xcalib_output_t * outputs = NULL;
+  size_t size = c->ramp->size * sizeof(unsigned short);
+  int ret = -1;
+
+  if(!display)
+    return -1;
+  if(xcalib_xrr_get_outputs(display, 0, xcalib_xrr_version(display), &outputs) == 1 &&
+     xcalib_xrr_set(display, outputs[0].crtc, c->ramp) == 0 &&
+     xcalib_xrr_get(display, outputs[0].crtc, c->back) == 0 &&
+     memcmp(c->back->red, c->ramp->red, size) == 0 &&
+     memcmp(c->back->green, c->ramp->green, size) == 0 &&
+     memcmp(c->back->blue, c->ramp->blue, size) == 0)
+    ret = 0;
+  free(outputs);
+  xcalib_display_close(display);
+
+  return ret;
+}
+#endif
+
+static const struct {
+  const char * name;
+  bench_stage_f func;
+} bench_stages[] = {
+  {"parse", stage_parse},
+  {"resample", stage_resample},
+  {"correct", stage_correct},
+  {"loss", stage_loss},
+  {"text", stage_text},
+  {"svg", stage_svg},
+#ifndef _WIN32
+  {"apply", stage_apply},
+#endif
+  {NULL, NULL}
+};
+
+/*
+ * FUNCTION bench_run
+ *
+ * repeats one stage until min_ms passed, at least three times
+ *
+ * returns
+ * -1: the stage failed
+ * 0: success; ns per entry and allocations per run are set
+ */
+static int
+bench_run(bench_stage_f func, bench_case_t * c, double min_ms,
+          double * ns_per_entry, double * allocs_per_run)
+{
+  long runs = 0, allocs;
+  double start, elapsed;
+
+  /* warm up caches and the ramp content */
+  if(func(c))
+    return -1;
+
+  allocs = bench_allocs;
+  start = xcalib_time_ms();
+  do {
+    if(func(c))
+      return -1;
+    ++runs;
+    elapsed = xcalib_time_ms() - start;
+  } while(runs < 3 || elapsed < min_ms);
+
+  *ns_per_entry = elapsed * 1000000.0 / runs / c->ramp->size;
+  *allocs_per_run = allocs < 0 ? -1 : (double)(bench_allocs - allocs) / runs;
+  return 0;
+}
+
+int
+main(int argc, char ** argv)
+{
+  const char * dir = ".";
+  double min_ms = 20;
+  int json = 0, first = 1, i, p, s, error = 0;
+  xcalib_state_t state = XCALIB_STATE_INIT;
+  xcalib_ramp_t * src;
+  FILE * null;
+
+  for(i = 1; i < argc; ++i)
+  {
+    if(strcmp(argv[i], "--json") == 0)
+      json = 1;
+    else if(strcmp(argv[i], "--time") == 0 && i + 1 < argc)
+      min_ms = atof(argv[++i]);
+    else if(argv[i][0] != '-')
+      dir = argv[i];
+    else
+    {
+      fprintf(stderr, "usage: %s [--json] [--time MILLISECONDS] [PROFILE_DIR]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  null = fopen(NULL_DEVICE, "w");
+  src = xcalib_ramp_new(256);
+  if(!null || !src)
+    return 1;
+  xcalib_set_correction(&state, 2.2, 10, 90);
+#ifdef XCALIB_BENCH_WRAP
+  bench_allocs = 0;
+#endif
+
+  if(json)
+    printf("{\n  \"version\": \"%s\",\n  \"min_ms\": %g,\n  \"results\": [", XCALIB_VERSION, min_ms);
+  else
+    printf("%-26s %-8s %6s %12s %10s\n", "profile", "stage", "size", "ns/entry", "allocs/run");
+
+  for(p = 0; bench_profiles[p]; ++p)
+  {
+    size_t len = strlen(dir) + strlen(bench_profiles[p]) + 2;
+    char * filename = (char *) malloc (len);
+    xcalib_state_t plain = XCALIB_STATE_INIT;
+
+    snprintf(filename, len, "%s/%s", dir, bench_profiles[p]);
+    if(xcalib_ramp_from_profile(src, filename, &plain) <= 0)
+    {
+      fprintf(stderr, "skipping %s: no calibration data\n", filename);
+      free(filename);
+      error = 1;
+      continue;
+    }
+
+    for(s = 16; s <= 65536; s *= 2)
+    {
+      bench_case_t c;
+      int st;
+
+      c.filename = filename;
+      c.ramp = xcalib_ramp_new(s);
+      c.src = src;
+      c.state = &state;
+      c.null = null;
+#ifndef _WIN32
+      snprintf(c.display, sizeof(c.display), "virtual:%d", s);
+      c.back = xcalib_ramp_new(s);
+      if(!c.back)
+        return 1;
+#endif
+      if(!c.ramp)
+        return 1;
+
+      for(st = 0; bench_stages[st].name; ++st)
+      {
+        double ns, allocs;
+
+        if(bench_run(bench_stages[st].func, &c, min_ms, &ns, &allocs))
+        {
+          fprintf(stderr, "%s failed for %s at %d\n", bench_stages[st].name, bench_profiles[p], s);
+          error = 1;
+          continue;
+        }
+        if(json)
+        {
+          printf("%s\n    {\"profile\": \"%s\", \"stage\": \"%s\", \"size\": %d, \"ns_per_entry\": %.3f, \"allocs_per_run\": %g}",
+                 first ? "" : ",", bench_profiles[p], bench_stages[st].name, s, ns, allocs);
+          first = 0;
+        }
+        else
+          printf("%-26s %-8s %6d %12.3f %10g\n", bench_profiles[p], bench_stages[st].name, s, ns, allocs);
+        fflush(stdout);
+      }
+      xcalib_ramp_release(&c.ramp);
+#ifndef _WIN32
+      xcalib_ramp_release(&c.back);
+#endif
+    }
+    free(filename);
+  }
+
+  if(json)
+    printf("\n  ]\n}\n");
+
+  xcalib_ramp_release(&src);
+  fclose(null);
+
+  return error;
+}